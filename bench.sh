@@ -0,0 +1,8 @@
+#!/bin/sh
+# Builds with optimizations and runs the benchmarks, e.g. ./bench.sh str parse
+mkdir -p build-bench
+cd build-bench
+cmake -DCMAKE_BUILD_TYPE=Bench ..
+make ferret_bench
+./ferret_bench "$@"
+cd ..
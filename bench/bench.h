@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Runs f once and reports the wall time and throughput for the given
+// number of items.
+template<class F> double measure(const char* name, size_t items, F f, const char* unit = "items")
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << s*1000 << " ms, " << size_t(items/s) << " " << unit << "/s\n";
+	return s;
+}
+
+std::string makeMenu(size_t lines, size_t extraFields);
+
+void benchFind();
+void benchIndex();
+void benchLinks();
+void benchLoad();
+void benchQueue();
+void benchSave();
+void benchScan();
+void benchParse();
+void benchStr();
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../src/find.h"
+
+namespace
+{
+	// every match the way a naive find would look for them
+	size_t naiveCount(const std::string& data, const std::string& needle, bool ignoreCase)
+	{
+		auto same = [ignoreCase](char a, char b) {
+			return ignoreCase ? tolower((unsigned char)a) == tolower((unsigned char)b) : a == b;
+		};
+		size_t count = 0;
+		for(auto i = data.begin(); (i = std::search(i, data.end(), needle.begin(), needle.end(), same)) != data.end(); i += needle.size())
+			++count;
+		return count;
+	}
+
+	size_t findCount(const std::string& data, const std::string& needle, bool ignoreCase)
+	{
+		size_t count = 0;
+		for(size_t pos = 0; (pos += findBytes(data.data() + pos, data.size() - pos, needle.data(), needle.size(), ignoreCase)) < data.size(); pos += needle.size())
+			++count;
+		return count;
+	}
+}
+
+// A 64 MiB text file with a rare word in it, and "ftftft...", where every
+// other byte passes the first and last byte test and has to be compared.
+void benchFind()
+{
+	const size_t SIZE = 64 * 0x100000;
+	std::mt19937 random(1);
+	const char* words[] = { "the", "gopher", "hole", "phlog", "of", "and", "menu", "text", "a", "server" };
+	std::string text;
+	while(text.size() < SIZE)
+	{
+		std::string line;
+		while(line.size() < 70)
+			line += std::string(words[random() % 10]) + " ";
+		if(random() % 10000 == 0)
+			line += "Ferret ";
+		text += line + "\n";
+	}
+	std::string same;
+	while(same.size() < SIZE)
+		same += "ft";
+	std::string needle = "ferret";
+
+	std::cout << "find in a " << SIZE / 0x100000 << " MiB text\n";
+	struct Input { const char* name; const std::string& data; } inputs[] = {
+		{ "text", text },
+		{ "ftftft", same },
+	};
+	size_t found = 0;
+	for(auto& in : inputs)
+	{
+		for(bool ignoreCase : { false, true })
+		{
+			std::string label = std::string(in.name) + (ignoreCase ? ", ignoring case" : "");
+			measure(("  naive, " + label).c_str(), in.data.size(), [&](){ found += naiveCount(in.data, needle, ignoreCase); }, "bytes");
+			measure(("  findBytes, " + label).c_str(), in.data.size(), [&](){ found += findCount(in.data, needle, ignoreCase); }, "bytes");
+		}
+	}
+
+	Page page;
+	parseText(text.data(), text.size(), page);
+	std::vector<FindMatch> matches;
+	measure("  findInPage, ignoring case", text.size(), [&](){ findInPage(page, needle, true, 0, matches); }, "bytes");
+	std::cout << "  " << matches.size() << " matches, " << found << " in all\n";
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../src/index.h"
+
+namespace
+{
+	void removeDirectory(const std::string& path)
+	{
+		if(DIR* d = opendir(path.c_str()))
+		{
+			while(dirent* e = readdir(d))
+			{
+				if(e->d_name[0] != '.')
+					unlink((path + "/" + e->d_name).c_str());
+			}
+			closedir(d);
+		}
+		rmdir(path.c_str());
+	}
+
+	// Word ranks drawn with Zipf-like frequencies, as in natural text.
+	struct Vocabulary
+	{
+		std::vector<std::string> words;
+		std::vector<double> cumulative;
+
+		Vocabulary(size_t size, std::mt19937& random)
+		{
+			double total = 0;
+			for(size_t i = 0; i < size; ++i)
+			{
+				std::string w;
+				for(size_t n = 3 + random() % 8; n; --n)
+					w += char('a' + random() % 26);
+				words.push_back(w);
+				total += 1.0 / (i + 1);
+				cumulative.push_back(total);
+			}
+		}
+
+		const std::string& pick(std::mt19937& random) const
+		{
+			double r = std::uniform_real_distribution<double>(0, cumulative.back())(random);
+			size_t i = std::lower_bound(cumulative.begin(), cumulative.end(), r) - cumulative.begin();
+			return words[std::min(i, words.size()-1)];
+		}
+	};
+
+	std::shared_ptr<const Page> makePage(const Vocabulary& vocabulary, std::mt19937& random)
+	{
+		std::shared_ptr<Page> page(new Page);
+		for(size_t lines = 10 + random() % 30; lines; --lines)
+		{
+			std::string line;
+			for(size_t n = 4 + random() % 8; n; --n)
+				line += vocabulary.pick(random) + " ";
+			page->addText(line);
+		}
+		return page;
+	}
+}
+
+void benchIndex()
+{
+	const size_t PAGES = 100000;
+	const size_t VOCABULARY = 50000;
+	const size_t QUERIES = 200;
+	const char* DIR_PATH = "/tmp/ferret-bench-index";
+
+	removeDirectory(DIR_PATH);
+	std::mt19937 random(1);
+	Vocabulary vocabulary(VOCABULARY, random);
+	std::vector<std::shared_ptr<const Page>> pages;
+	for(size_t i = 0; i < PAGES; ++i)
+		pages.push_back(makePage(vocabulary, random));
+
+	std::cout << "search index of " << PAGES << " pages\n";
+	{
+		SearchIndex index;
+		index.open(DIR_PATH);
+		measure("  add and flush", PAGES, [&](){
+			for(size_t i = 0; i < PAGES; ++i)
+				index.add("gopher://host" + std::to_string(i % 100) + "/0/page" + std::to_string(i), pages[i]);
+			index.flush();
+		}, "pages");
+		pages.clear();
+
+		// common, middling and rare words, one to three at a time
+		std::vector<std::string> queries;
+		for(size_t i = 0; i < QUERIES; ++i)
+		{
+			std::string q;
+			for(size_t n = 1 + i % 3; n; --n)
+				q += vocabulary.words[size_t(std::pow(VOCABULARY, double(random() % 1000) / 1000))] + " ";
+			queries.push_back(q);
+		}
+		std::vector<double> times;
+		size_t found = 0;
+		for(auto& q : queries)
+		{
+			auto start = std::chrono::steady_clock::now();
+			found += index.search(q, 20).size();
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(times.begin(), times.end());
+		char buf[128];
+		snprintf(buf, sizeof(buf), "  search: p50 %.2f ms, p99 %.2f ms, %zu results\n",
+			times[times.size()/2], times[times.size()*99/100], found);
+		std::cout << buf;
+		index.close();
+	}
+	{
+		SearchIndex index;
+		measure("  reopen", 1, [&](){ index.open(DIR_PATH); }, "opens");
+		std::cout << "  " << index.size() << " pages after reopening\n";
+	}
+	removeDirectory(DIR_PATH);
+}
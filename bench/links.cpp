@@ -0,0 +1,49 @@
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "../src/link.h"
+
+// The scan tagEvent used to do for every click.
+const Link* legacyFindLink(const std::vector<Link>& links, int offset)
+{
+	for(auto& l : links)
+	{
+		if(offset >= l.start && offset < l.end)
+			return &l;
+	}
+	return 0;
+}
+
+void benchLinks()
+{
+	const size_t LINKS = 100000;
+	const size_t SCANS = 1000;
+	const size_t SEARCHES = 1000000;
+
+	// laid out as appendItems would: an icon, a spacer, the text, a newline
+	std::vector<Link> links;
+	int offset = 0;
+	for(size_t i = 0; i < LINKS; ++i)
+	{
+		int length = 20 + i % 40;
+		links.push_back({Link::LINK, offset + 5, offset + 5 + length, i});
+		offset += 5 + length + 1;
+	}
+	std::mt19937 random(1);
+	std::vector<int> offsets(SEARCHES);
+	for(auto& o : offsets)
+		o = random() % offset;
+
+	std::cout << "link lookup in " << LINKS << " links\n";
+	size_t found = 0;
+	measure("  linear scan", SCANS, [&](){
+		for(size_t i = 0; i < SCANS; ++i)
+			found += legacyFindLink(links, offsets[i]) != 0;
+	}, "lookups");
+	measure("  findLink", SEARCHES, [&](){
+		for(size_t i = 0; i < SEARCHES; ++i)
+			found += findLink(links, offsets[i]) != 0;
+	}, "lookups");
+	if(!found)
+		std::cout << "  (no links found)\n";
+}
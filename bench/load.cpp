@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "bench.h"
+#include "testd.h"
+#include "../src/queue.h"
+#include "../src/timing.h"
+#include "../src/worker.h"
+
+namespace
+{
+	struct Scenario
+	{
+		const char* name;
+		std::string selector;
+		size_t requests;
+		size_t concurrency;
+		bool save;
+		bool slowAccepts;
+	};
+
+	// Runs a TestServer on each of hosts loopback addresses, 127.0.0.1 up,
+	// in a child process, so the CPU time measured here is the client's
+	// alone. Fills in each one's gopher://address:port and returns the
+	// child's pid, or -1.
+	pid_t startServers(int acceptDelay, size_t hosts, std::vector<std::string>& bases)
+	{
+		std::vector<std::unique_ptr<TestServer>> servers;
+		for(size_t i = 0; i < hosts; ++i)
+		{
+			servers.emplace_back(new TestServer);
+			TestServer& server = *servers.back();
+			server.address = "127.0.0." + std::to_string(i + 1);
+			server.acceptDelay = acceptDelay;
+			if(!server.listen(0))
+				return -1;
+			bases.push_back("gopher://" + server.address + ":" + std::to_string(server.port));
+		}
+		pid_t pid = fork();
+		if(pid == 0)
+		{
+			for(size_t i = 1; i < hosts; ++i)
+				std::thread(&TestServer::run, servers[i].get()).detach();
+			servers[0]->run();
+			_exit(0);
+		}
+		// shutting the listeners down here would stop the child's too
+		for(auto& server : servers)
+		{
+			close(server->listener);
+			server->listener = -1;
+		}
+		return pid;
+	}
+
+	double cpuMilliseconds()
+	{
+		rusage u;
+		getrusage(RUSAGE_SELF, &u);
+		return (u.ru_utime.tv_sec + u.ru_stime.tv_sec) * 1e3 + (u.ru_utime.tv_usec + u.ru_stime.tv_usec) / 1e3;
+	}
+
+	void waitQueue()
+	{
+		pollfd p = { queueEvent, POLLIN, 0 };
+		if(!dataQueue.size())
+			poll(&p, 1, -1);
+		uint64_t count;
+		while(read(queueEvent, &count, sizeof(count)) > 0);
+		queueSignalled = false;
+	}
+
+	struct InFlight
+	{
+		int64_t start;
+		size_t host;
+		std::string path;
+	};
+
+	// Each request goes to the server with the fewest in flight, so no
+	// address is held back by the worker's MAX_HOST_CONNECTIONS while
+	// others sit idle. Saves go to a file of their own, made with mkstemp.
+	void run(const Scenario& s, const std::vector<std::string>& bases)
+	{
+		std::unordered_map<int, InFlight> started;
+		std::vector<size_t> perHost(bases.size());
+		std::vector<double> latencies;
+		std::vector<Message> messages;
+		size_t issued = 0, failed = 0, bytes = 0;
+
+		double cpu = cpuMilliseconds();
+		int64_t start = steadyMicroseconds();
+		while(latencies.size() < s.requests)
+		{
+			while(issued < s.requests && started.size() < s.concurrency)
+			{
+				size_t host = std::min_element(perHost.begin(), perHost.end()) - perHost.begin();
+				std::string url = bases[host] + "/0" + s.selector;
+				std::string path;
+				int reqid;
+				if(s.save)
+				{
+					char name[] = "/tmp/ferret-bench-loadXXXXXX";
+					int fd = mkstemp(name);
+					if(fd == -1)
+					{
+						std::cout << "  " << s.name << ": could not create a file: " << strerror(errno) << "\n";
+						for(auto& i : started)
+						{
+							cancel(i.first);
+							unlink(i.second.path.c_str());
+						}
+						return;
+					}
+					close(fd);
+					path = name;
+					reqid = download(url, path, 0, FOREGROUND);
+				}
+				else
+				{
+					reqid = newRequest();
+					fetch(reqid, url, 0);
+				}
+				started[reqid] = { steadyMicroseconds(), host, path };
+				++perHost[host];
+				++issued;
+			}
+			waitQueue();
+			dataQueue.popAll(messages);
+			for(auto& m : messages)
+			{
+				if(m.type == Message::DATA)
+					continue;
+				auto i = started.find(m.reqid);
+				if(i == started.end())
+					continue;
+				latencies.push_back((steadyMicroseconds() - i->second.start) / 1000.0);
+				--perHost[i->second.host];
+				if(s.save)
+					unlink(i->second.path.c_str());
+				started.erase(i);
+				bytes += m.timing.bytes;
+				failed += m.type == Message::ERROR;
+			}
+			messages.clear();
+		}
+		double seconds = (steadyMicroseconds() - start) / 1e6;
+		cpu = cpuMilliseconds() - cpu;
+
+		std::sort(latencies.begin(), latencies.end());
+		double p50 = latencies[latencies.size() / 2];
+		double p99 = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+		char line[256];
+		snprintf(line, sizeof(line), "  %s: %zu requests, %zu at once, %zu failed, %.0f req/s, %.1f MB/s, p50 %.1f ms, p99 %.1f ms, CPU %.0f ms",
+			s.name, s.requests, s.concurrency, failed, s.requests / seconds, bytes / seconds / 1e6, p50, p99, cpu);
+		std::cout << line << "\n";
+	}
+}
+
+// Drives the worker against ferret_testd's content on loopback addresses.
+void benchLoad()
+{
+	Scenario scenarios[] = {
+		{ "small menus", "/menu/50", 5000, 64, false, false },
+		{ "1 MiB files", "/file/1048576", 200, 16, false, false },
+		{ "16 MiB saves", "/file/16777216", 32, 4, true, false },
+		{ "trickles", "/trickle/8192/5", 32, 32, false, false },
+		{ "stalls", "/stall/200", 16, 16, false, false },
+		{ "resets", "/reset/100000", 500, 16, false, false },
+		{ "slow accepts", "/menu/10", 100, 16, false, true },
+	};
+	// enough addresses that the busiest scenario is not held back by the
+	// worker's limit on connections to one host
+	size_t hosts = 1;
+	for(auto& s : scenarios)
+		hosts = std::max(hosts, (s.concurrency + MAX_HOST_CONNECTIONS - 1) / MAX_HOST_CONNECTIONS);
+	std::vector<std::string> bases, slowBases;
+	pid_t server = startServers(0, hosts, bases);
+	pid_t slowServer = startServers(20, hosts, slowBases);
+	if(server == -1 || slowServer == -1)
+	{
+		std::cout << "load: could not start the test servers\n";
+		for(pid_t pid : { server, slowServer })
+		{
+			if(pid != -1)
+			{
+				kill(pid, SIGTERM);
+				waitpid(pid, 0, 0);
+			}
+		}
+		return;
+	}
+
+	std::thread worker = startWorker();
+	std::cout << "load on " << hosts << " loopback addresses\n";
+	for(auto& s : scenarios)
+		run(s, s.slowAccepts ? slowBases : bases);
+	endWorker();
+	worker.join();
+
+	kill(server, SIGTERM);
+	kill(slowServer, SIGTERM);
+	waitpid(server, 0, 0);
+	waitpid(slowServer, 0, 0);
+}
@@ -0,0 +1,47 @@
+#include <atomic>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../src/queue.h"
+
+MessageQueue dataQueue;
+int queueEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+std::atomic<bool> queueSignalled(false);
+
+void queueData(Message&& m)
+{
+	dataQueue.push(std::move(m));
+	if(!queueSignalled.exchange(true))
+	{
+		uint64_t one = 1;
+		if(write(queueEvent, &one, sizeof(one)) == -1)
+			std::cerr << "Failed to signal queue: " << strerror(errno) << "\n";
+	}
+}
+
+// With no arguments every benchmark runs; otherwise only the named ones,
+// e.g. ferret_bench str parse
+int main(int argc, char** argv)
+{
+	struct { const char* name; void (*run)(); } benches[] = {
+		{ "queue", benchQueue },
+		{ "parse", benchParse },
+		{ "str", benchStr },
+		{ "links", benchLinks },
+		{ "save", benchSave },
+		{ "load", benchLoad },
+		{ "index", benchIndex },
+		{ "find", benchFind },
+		{ "scan", benchScan },
+	};
+	for(auto& b : benches)
+	{
+		bool wanted = argc == 1;
+		for(int i = 1; i < argc; ++i)
+			wanted = wanted || !strcmp(argv[i], b.name);
+		if(wanted)
+			b.run();
+	}
+	return 0;
+}
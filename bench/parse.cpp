@@ -0,0 +1,106 @@
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../src/gopher.h"
+#include "../src/str.h"
+
+// Node and parseList as they were before MenuParser, kept for comparison.
+struct Node
+{
+	int type = TYPE_UNKNOWN;
+	char code;
+	std::string text;
+	std::string path;
+	std::string host;
+	std::string port;
+	std::string url;
+};
+
+void legacyParseList(const std::string& data, std::vector<Node>& nodes)
+{
+	std::vector<std::string> lines;
+	splitLines(data, lines);
+	for(std::string& line : lines)
+	{
+		if(line.size() > 1)
+		{
+			Node n;
+			char c = line[0];
+			n.code = c;
+			n.type = docType(c);
+			std::vector<std::string> parts;
+			line.erase(0, 1);
+			while(line.size())
+			{
+				auto i = line.find('\t');
+				parts.push_back(line.substr(0, i));
+				if(i == std::string::npos)
+					line.clear();
+				else
+					line.erase(0, i+1);
+			}
+			if((n.type != TYPE_INFO) && parts.size() >= 4)
+			{
+				n.path = parts[1];
+				if(n.path[0] != '/')
+					n.path.insert(0, "/");
+				n.host = parts[2];
+				n.port = strip(parts[3]);
+				if(n.port != "70")
+					n.url = "gopher://"+(n.host + ":" + n.port + "/" + n.code + n.path);
+				else
+					n.url = "gopher://"+(n.host + "/" + n.code + n.path);
+			}
+			n.text = parts[0] + "\n";
+			nodes.push_back(n);
+		}
+	}
+}
+
+// extraFields appends gopher+ style trailing fields to every item
+std::string makeMenu(size_t lines, size_t extraFields)
+{
+	std::string menu;
+	std::string text(40, 'a');
+	std::string extra;
+	for(size_t i = 0; i < extraFields; ++i)
+		extra += "\t+";
+	for(size_t i = 0; i < lines; ++i)
+	{
+		if(i % 4 == 0)
+			menu += "i" + text + "\tfake\terror.host\t1" + extra + "\r\n";
+		else
+			menu += "1" + text + " " + std::to_string(i) + "\t/dir/" + std::to_string(i) + "\tgopher.example.org\t70" + extra + "\r\n";
+	}
+	menu += ".\r\n";
+	return menu;
+}
+
+void benchParse()
+{
+	const size_t LINES = 100000;
+	const size_t CHUNK = 0x10000;
+	std::string menus[] = { makeMenu(LINES, 0), makeMenu(LINES/100, 10000), std::string(0x400000, 'x'), std::string(0x100000, '\n') };
+	const char* names[] = { "100k-line menu", "1k lines with 10k fields", "one 4 MiB line", "1M empty lines" };
+
+	for(int i = 0; i < 4; ++i)
+	{
+		const std::string& menu = menus[i];
+		std::cout << names[i] << " (" << menu.size() << " bytes)\n";
+		measure("  legacy parseList", menu.size(), [&](){
+			std::vector<Node> nodes;
+			legacyParseList(menu, nodes);
+		}, "bytes");
+		measure("  parseList", menu.size(), [&](){
+			Page page;
+			parseList(menu.data(), menu.size(), page);
+		}, "bytes");
+		measure("  MenuParser, 64k chunks", menu.size(), [&](){
+			Page page;
+			MenuParser parser;
+			for(size_t p = 0; p < menu.size(); p += CHUNK)
+				parser.feed(page, menu.data() + p, std::min(CHUNK, menu.size() - p));
+			parser.finish(page);
+		}, "bytes");
+	}
+}
@@ -0,0 +1,117 @@
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "../src/queue.h"
+
+// The mutex + vector queue MessageQueue replaced, kept for comparison.
+struct OldMessage
+{
+	int reqid;
+	int type;
+	std::string data;
+};
+
+struct LockedQueue
+{
+	std::vector<OldMessage> queue;
+	std::mutex queueMtx;
+
+	OldMessage pop()
+	{
+		std::unique_lock<std::mutex> lock(queueMtx);
+		OldMessage m = queue[0];
+		queue.erase(queue.begin());
+		return m;
+	}
+
+	void push(const OldMessage& m)
+	{
+		std::unique_lock<std::mutex> lock(queueMtx);
+		queue.push_back(m);
+	}
+
+	size_t size() const { return queue.size(); }
+};
+
+const size_t CHUNK_SIZE = 4096;
+const size_t BURST = 20000;
+const size_t MESSAGES = 1000000;
+const size_t BATCH = 64;
+
+void benchQueue()
+{
+	std::string chunk(CHUNK_SIZE, 'x');
+	size_t bytes = 0;
+
+	// the UI falls behind and drains a backlog of chunks in one go
+	measure("LockedQueue burst", BURST, [&](){
+		LockedQueue q;
+		for(size_t i = 0; i < BURST; ++i)
+			q.push({int(i), 0, chunk});
+		while(q.size())
+			bytes += q.pop().data.size();
+	});
+	measure("MessageQueue burst", BURST, [&](){
+		MessageQueue q;
+		std::vector<Message> out;
+		for(size_t i = 0; i < BURST; ++i)
+		{
+			if(!q.tryPush({int(i), Message::DATA, chunk}))
+			{
+				q.popAll(out);
+				for(auto& m : out)
+					bytes += m.data.size();
+				out.clear();
+				--i;
+			}
+		}
+		q.popAll(out);
+		for(auto& m : out)
+			bytes += m.data.size();
+	});
+
+	// small batches, as when the UI keeps up with the worker
+	measure("LockedQueue batches", MESSAGES, [&](){
+		LockedQueue q;
+		for(size_t i = 0; i < MESSAGES; i += BATCH)
+		{
+			for(size_t j = 0; j < BATCH; ++j)
+				q.push({int(i+j), 0, std::string()});
+			while(q.size())
+				q.pop();
+		}
+	});
+	measure("MessageQueue batches", MESSAGES, [&](){
+		MessageQueue q;
+		std::vector<Message> out;
+		for(size_t i = 0; i < MESSAGES; i += BATCH)
+		{
+			for(size_t j = 0; j < BATCH; ++j)
+				q.push({int(i+j), Message::DATA, std::string()});
+			out.clear();
+			q.popAll(out);
+		}
+	});
+
+	// the worker and UI threads at full speed, with the ring often full
+	const size_t THREADED = MESSAGES / 10;
+	measure("MessageQueue, two threads", THREADED, [&](){
+		MessageQueue q;
+		std::thread producer([&](){
+			for(size_t i = 0; i < THREADED; ++i)
+				q.push({int(i), Message::DATA, std::string()});
+		});
+		std::vector<Message> out;
+		size_t received = 0;
+		while(received < THREADED)
+		{
+			out.clear();
+			received += q.popAll(out);
+		}
+		producer.join();
+	});
+
+	std::cout << "(" << bytes << " bytes moved)\n";
+}
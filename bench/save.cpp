@@ -0,0 +1,80 @@
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../src/fd.h"
+#include "../src/queue.h"
+#include "../src/worker.h"
+
+// Answers every request on a loopback port with size bytes.
+void serve(int listener, size_t size, int requests)
+{
+	std::vector<char> chunk(0x100000, 'x');
+	for(int i = 0; i < requests; ++i)
+	{
+		int c = accept(listener, 0, 0);
+		if(c == -1)
+			return;
+		char selector[256];
+		ssize_t r;
+		while((r = recv(c, selector, sizeof(selector), 0)) > 0 && !memchr(selector, '\n', r));
+		for(size_t sent = 0; sent < size;)
+		{
+			ssize_t s = send(c, chunk.data(), std::min(chunk.size(), size - sent), MSG_NOSIGNAL);
+			if(s <= 0)
+				break;
+			sent += s;
+		}
+		close(c);
+	}
+}
+
+void benchSave()
+{
+	const size_t SIZE = 256 * 0x100000;
+	const char* PATH = "/tmp/ferret-bench-save";
+
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t length = sizeof(addr);
+	if(listener == -1 || bind(listener, (sockaddr*)&addr, sizeof(addr)) || listen(listener, 4)
+		|| getsockname(listener, (sockaddr*)&addr, &length))
+	{
+		std::cout << "save: could not listen on loopback\n";
+		return;
+	}
+	std::string url = "gopher://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/9/file";
+	std::thread server(serve, listener, SIZE, 2);
+	std::thread worker = startWorker();
+
+	std::cout << "save " << SIZE / 0x100000 << " MiB from loopback\n";
+	for(bool splice : { false, true })
+	{
+		spliceDownloads = splice;
+		unlink(PATH);
+		measure(splice ? "  splice" : "  recv + write", SIZE, [&](){
+			download(url, PATH, SIZE);
+			Message m;
+			while(!dataQueue.pop(m))
+				usleep(1000);
+		}, "bytes");
+		struct stat st;
+		if(stat(PATH, &st) || size_t(st.st_size) != SIZE)
+			std::cout << "  (saved file has the wrong size)\n";
+	}
+	unlink(PATH);
+
+	endWorker();
+	worker.join();
+	server.join();
+	close(listener);
+	if(openDescriptors())
+		std::cout << "  (" << openDescriptors() << " descriptors left open)\n";
+}
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../src/gopher.h"
+#include "../src/scan.h"
+#include "../src/str.h"
+
+// What scanBytes is measured against: MenuParser used to step through
+// each field a byte at a time, and TextParser and splitLines call memchr
+// once per line.
+size_t legacyCountFields(const char* data, size_t size)
+{
+	size_t count = 0;
+	for(size_t pos = 0; pos < size; ++pos)
+	{
+		while(pos < size && data[pos] != '\t' && data[pos] != '\n')
+			++pos;
+		count += pos < size;
+	}
+	return count;
+}
+
+size_t memchrCountLines(const char* data, size_t size)
+{
+	size_t count = 0;
+	const char* end = data + size;
+	for(const char* p = data; (p = static_cast<const char*>(memchr(p, '\n', end - p))); ++p)
+		++count;
+	return count;
+}
+
+size_t countBytes(const char* data, size_t size, char a, char b)
+{
+	const size_t WINDOW = 0x10000;
+	std::vector<uint32_t> offsets;
+	size_t count = 0;
+	for(size_t pos = 0; pos < size; pos += WINDOW)
+	{
+		offsets.clear();
+		scanBytes(data + pos, std::min(size - pos, WINDOW), a, b, pos, offsets);
+		count += offsets.size();
+	}
+	return count;
+}
+
+// Menus and text files of 1, 10 and 100 MiB, scanned for delimiters and
+// parsed into pages.
+void benchScan()
+{
+	std::string line = "A line of a gopher text file, about as long as most are\n";
+	std::string baseMenu = makeMenu(2000, 0);
+	for(size_t mib : { 1, 10, 100 })
+	{
+		size_t size = mib * 0x100000;
+		std::string text, menu;
+		while(text.size() < size)
+			text += line;
+		while(menu.size() < size)
+			menu += baseMenu.substr(0, baseMenu.size() - 3);
+		menu += ".\r\n";
+
+		std::cout << "scan " << mib << " MiB\n";
+		size_t found = 0;
+		measure("  legacy fields, menu", menu.size(), [&](){ found += legacyCountFields(menu.data(), menu.size()); }, "bytes");
+		measure("  scanBytes fields, menu", menu.size(), [&](){ found += countBytes(menu.data(), menu.size(), '\t', '\n'); }, "bytes");
+		measure("  memchr lines, text", text.size(), [&](){ found += memchrCountLines(text.data(), text.size()); }, "bytes");
+		measure("  scanBytes lines, text", text.size(), [&](){ found += countBytes(text.data(), text.size(), '\n', '\n'); }, "bytes");
+		measure("  parseList, menu", menu.size(), [&](){
+			Page page;
+			parseList(menu.data(), menu.size(), page);
+			found += page.size();
+		}, "bytes");
+		measure("  parseText, text", text.size(), [&](){
+			Page page;
+			parseText(text.data(), text.size(), page);
+			found += page.size();
+		}, "bytes");
+		measure("  splitLines, text", text.size(), [&](){
+			std::vector<std::string> lines;
+			splitLines(text, lines);
+			found += lines.size();
+		}, "bytes");
+		if(!found)
+			std::cout << "  (nothing found)\n";
+	}
+}
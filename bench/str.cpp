@@ -0,0 +1,58 @@
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../src/str.h"
+
+// Each helper is run over a realistic input and over one that hits its
+// worst case.
+void benchStr()
+{
+	std::string text;
+	for(size_t i = 0; i < 50000; ++i)
+		text += "A line of a gopher text file, about as long as most are " + std::to_string(i) + "\n";
+	std::string blankLines(0x100000, '\n');
+	std::string longLine(0x400000, 'x');
+
+	struct Input { const char* name; const std::string& data; } splits[] = {
+		{ "  splitLines, 50k text lines", text },
+		{ "  splitLines, 1M empty lines", blankLines },
+		{ "  splitLines, one 4 MiB line", longLine },
+	};
+	std::cout << "str\n";
+	for(auto& in : splits)
+	{
+		measure(in.name, in.data.size(), [&](){
+			std::vector<std::string> lines;
+			splitLines(in.data, lines);
+		}, "bytes");
+	}
+
+	// every tab in a selector, and a string that is nothing but matches
+	std::string selector = "/users/someone/phlog/2019/a\tquery\twith\ttabs";
+	std::string tabs(0x4000, '\t');
+	measure("  replaceAll, 100k selectors", 100000, [&](){
+		for(size_t i = 0; i < 100000; ++i)
+		{
+			std::string s = selector;
+			replaceAll(s, "\t", "%09");
+		}
+	}, "strings");
+	measure("  replaceAll, 16k matches", tabs.size(), [&](){
+		std::string s = tabs;
+		replaceAll(s, "\t", "%09");
+	}, "bytes");
+
+	std::string port = " 70\r";
+	std::string padded = std::string(0x10000, ' ') + "x" + std::string(0x10000, ' ');
+	measure("  strip, 1M ports", 1000000, [&](){
+		for(size_t i = 0; i < 1000000; ++i)
+		{
+			std::string s = port;
+			strip(s);
+		}
+	}, "strings");
+	measure("  strip, 128k spaces", padded.size(), [&](){
+		std::string s = padded;
+		strip(s);
+	}, "bytes");
+}
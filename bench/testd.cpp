@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "testd.h"
+
+const size_t TRICKLE_CHUNK = 512;
+const size_t PATTERN_SIZE = 0x10000;
+
+namespace
+{
+	// 64-byte lines of text, so files look like files
+	std::string makePattern()
+	{
+		std::string p;
+		for(size_t i = 0; p.size() < PATTERN_SIZE; ++i)
+		{
+			std::string line = "line " + std::to_string(i) + " ";
+			line.resize(63, 'x');
+			p += line + "\n";
+		}
+		return p;
+	}
+
+	const std::string& pattern()
+	{
+		static const std::string p = makePattern();
+		return p;
+	}
+
+	bool sendAll(int c, const char* data, size_t size)
+	{
+		while(size)
+		{
+			ssize_t s = send(c, data, size, MSG_NOSIGNAL);
+			if(s <= 0)
+				return false;
+			data += s;
+			size -= s;
+		}
+		return true;
+	}
+
+	bool sendFile(int c, size_t size, size_t chunk = PATTERN_SIZE)
+	{
+		const std::string& p = pattern();
+		for(size_t sent = 0; sent < size;)
+		{
+			size_t n = std::min(std::min(chunk, PATTERN_SIZE), size - sent);
+			if(!sendAll(c, p.data(), n))
+				return false;
+			sent += n;
+		}
+		return true;
+	}
+
+	void pause(TestServer* s, size_t ms)
+	{
+		auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+		while(!s->stopping && std::chrono::steady_clock::now() < end)
+			std::this_thread::sleep_for(std::chrono::milliseconds(std::min(ms, size_t(10))));
+	}
+
+	std::string menu(TestServer* s, size_t items)
+	{
+		std::string port = std::to_string(s->port);
+		std::string out;
+		for(size_t i = 0; i < items; ++i)
+		{
+			std::string n = std::to_string(i);
+			if(i % 8 == 0)
+				out += "iSection " + n + "\tfake\terror.host\t1\r\n";
+			else if(i % 8 == 1)
+				out += "1Menu " + n + "\t/menu/" + n + "\t" + s->address + "\t" + port + "\r\n";
+			else
+				out += "0File " + n + "\t/file/" + std::to_string(1000 + i) + "\t" + s->address + "\t" + port + "\r\n";
+		}
+		return out + ".\r\n";
+	}
+
+	std::string examples(TestServer* s)
+	{
+		std::string port = std::to_string(s->port);
+		const char* items[] = {
+			"1A menu of 100 items\t/menu/100",
+			"0A 1 MiB file\t/file/1048576",
+			"0A 16 KiB file, 512 bytes every 50 ms\t/trickle/16384/50",
+			"0Nothing for 5 s\t/stall/5000",
+			"0A reset after 1000 bytes\t/reset/1000",
+		};
+		std::string out = "iferret_testd\tfake\terror.host\t1\r\n";
+		for(auto item : items)
+			out += std::string(item) + "\t" + s->address + "\t" + port + "\r\n";
+		return out + ".\r\n";
+	}
+
+	void serveClient(TestServer* s, int c)
+	{
+		std::string selector;
+		char buf[1024];
+		ssize_t r;
+		while(selector.find('\n') == std::string::npos && (r = recv(c, buf, sizeof(buf), 0)) > 0)
+			selector.append(buf, r);
+		selector = selector.substr(0, selector.find_first_of("\r\n"));
+
+		char kind[16] = "";
+		size_t a = 0, b = 0;
+		sscanf(selector.c_str(), "/%15[a-z]/%zu/%zu", kind, &a, &b);
+		std::string k = kind;
+		if(k == "menu")
+		{
+			std::string m = menu(s, a);
+			sendAll(c, m.data(), m.size());
+		}
+		else if(k == "file")
+			sendFile(c, a);
+		else if(k == "trickle")
+		{
+			for(size_t sent = 0; sent < a && !s->stopping; sent += TRICKLE_CHUNK)
+			{
+				if(!sendFile(c, std::min(TRICKLE_CHUNK, a - sent)))
+					break;
+				pause(s, b);
+			}
+		}
+		else if(k == "stall")
+			pause(s, a);
+		else if(k == "reset")
+		{
+			sendFile(c, a);
+			linger l = { 1, 0 };
+			setsockopt(c, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+		}
+		else
+		{
+			std::string m = examples(s);
+			sendAll(c, m.data(), m.size());
+		}
+		close(c);
+		--s->active;
+	}
+}
+
+TestServer::~TestServer()
+{
+	stop();
+}
+
+bool TestServer::listen(int p)
+{
+	listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(listener == -1)
+		return false;
+	int one = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(p);
+	socklen_t length = sizeof(addr);
+	if(inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1 || bind(listener, (sockaddr*)&addr, sizeof(addr)) || ::listen(listener, 128)
+		|| getsockname(listener, (sockaddr*)&addr, &length))
+	{
+		close(listener);
+		listener = -1;
+		return false;
+	}
+	port = ntohs(addr.sin_port);
+	return true;
+}
+
+// Accepts until stop() is called.
+void TestServer::run()
+{
+	while(!stopping)
+	{
+		if(acceptDelay)
+			pause(this, acceptDelay);
+		int c = accept4(listener, 0, 0, SOCK_CLOEXEC);
+		if(c == -1)
+		{
+			if(errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+		++active;
+		std::thread(serveClient, this, c).detach();
+	}
+}
+
+// Wakes run() and waits for open connections to finish.
+void TestServer::stop()
+{
+	stopping = true;
+	if(listener != -1)
+	{
+		shutdown(listener, SHUT_RDWR);
+		close(listener);
+		listener = -1;
+	}
+	while(active)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+// Serves synthetic gopher content on a loopback address, 127.0.0.1 unless
+// address is set, one thread per connection.
+//   /menu/N          a menu of N items linking to files and smaller menus
+//   /file/N          N bytes of text
+//   /trickle/N/MS    N bytes, TRICKLE_CHUNK at a time, MS milliseconds apart
+//   /stall/MS        nothing for MS milliseconds, then close
+//   /reset/N         N bytes, then a connection reset
+// Anything else gets a menu of examples. acceptDelay sleeps that many
+// milliseconds before every accept, to stand in for an overloaded server.
+struct TestServer
+{
+	std::string address = "127.0.0.1";
+	int listener = -1;
+	int port = 0;
+	int acceptDelay = 0;
+	std::atomic<bool> stopping{false};
+	std::atomic<int> active{0};
+
+	~TestServer();
+
+	// port 0 picks any free port
+	bool listen(int port);
+	void run();
+	void stop();
+};
@@ -0,0 +1,26 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "testd.h"
+
+// ferret_testd [-p port] [--accept-delay ms]
+int main(int argc, char** argv)
+{
+	int port = 7070;
+	TestServer server;
+	for(int i = 1; i+1 < argc; i += 2)
+	{
+		if(!strcmp(argv[i], "-p"))
+			port = atoi(argv[i+1]);
+		else if(!strcmp(argv[i], "--accept-delay"))
+			server.acceptDelay = atoi(argv[i+1]);
+	}
+	if(!server.listen(port))
+	{
+		std::cerr << "Could not listen on " << server.address << ":" << port << "\n";
+		return 1;
+	}
+	std::cout << "Serving gopher://" << server.address << ":" << server.port << "/\n";
+	server.run();
+	return 0;
+}
@@ -0,0 +1,105 @@
+#include <vector>
+#include "bench.h"
+#include "../src/gopher.h"
+#include "../src/pagebuffer.h"
+
+// addText and addLink as they were before appendItems, kept for comparison.
+void legacyAddText(GtkTextBuffer* buffer, const char* text, size_t length)
+{
+	GtkTextIter end;
+	gtk_text_buffer_get_iter_at_offset(buffer, &end, -1);
+	gtk_text_buffer_insert(buffer, &end, text, length);
+	gtk_text_buffer_insert(buffer, &end, "\n", 1);
+}
+
+void legacyAddLink(GtkTextBuffer* buffer, const char* text, size_t length, size_t item, GdkPixbuf* icon, std::vector<Link>& links)
+{
+	auto link = gtk_text_tag_table_lookup(gtk_text_buffer_get_tag_table(buffer), "link");
+
+	GtkTextIter end;
+	gtk_text_buffer_get_iter_at_offset(buffer, &end, -1);
+	int startOffset = gtk_text_iter_get_offset(&end);
+
+	if(icon)
+	{
+		auto iconTag = gtk_text_tag_table_lookup(gtk_text_buffer_get_tag_table(buffer), "icon");
+		gtk_text_buffer_insert_pixbuf(buffer, &end, icon);
+
+		GtkTextIter start;
+		gtk_text_buffer_get_iter_at_offset(buffer, &start, startOffset);
+
+		gtk_text_buffer_get_iter_at_offset(buffer, &end, -1);
+		gtk_text_buffer_apply_tag(buffer, iconTag, &start, &end);
+	}
+	gtk_text_buffer_insert(buffer, &end, "    ", 4);
+	gtk_text_buffer_get_iter_at_offset(buffer, &end, -1);
+	int linkOffset = gtk_text_iter_get_offset(&end);
+	gtk_text_buffer_insert_with_tags(buffer, &end, text, length, link, nullptr);
+	gtk_text_buffer_insert(buffer, &end, "\n", 1);
+	links.push_back({Link::LINK, linkOffset, linkOffset+int(length), item});
+}
+
+// Fills a buffer in batches of BATCH items, as the UI does while a page
+// streams in, and reports the cost per item of the batches that land
+// after each checkpoint so growth with buffer size shows up.
+template<class F> void fill(const char* name, const Page& page, F append)
+{
+	const size_t BATCH = 1000;
+	const size_t checkpoints[] = { 1000, 10000, 50000, 100000 };
+	std::cout << name << "\n";
+	size_t from = 0;
+	for(size_t checkpoint : checkpoints)
+	{
+		if(checkpoint > page.size())
+			break;
+		auto start = std::chrono::steady_clock::now();
+		size_t first = from;
+		for(; from < checkpoint; from += BATCH)
+			append(from, std::min(from + BATCH, page.size()));
+		double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "  items " << first << "-" << checkpoint << ": " << s * 1e9 / (checkpoint - first) << " ns/item\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t LINES = 100000;
+	std::string menu = makeMenu(LINES, 0);
+	Page page;
+	parseList(menu.data(), menu.size(), page);
+
+	GdkPixbuf* icons[TYPE_MAX] = {};
+	icons[TYPE_DIR] = gdk_pixbuf_new(GDK_COLORSPACE_RGB, true, 8, 18, 28);
+	GdkRGBA blue = {0, 0, 1, 1};
+
+	{
+		auto buffer = gtk_text_buffer_new(0);
+		gtk_text_buffer_create_tag(buffer, "icon", "rise", -7 * PANGO_SCALE, "rise-set", true, nullptr);
+		gtk_text_buffer_create_tag(buffer, "link", "underline", true, "foreground-rgba", &blue, nullptr);
+		std::vector<Link> links;
+		fill("legacy addText/addLink", page, [&](size_t from, size_t to){
+			for(size_t i = from; i < to; ++i)
+			{
+				if(page.types[i] == TYPE_INFO)
+					legacyAddText(buffer, page.text(i), page.textLength(i));
+				else
+					legacyAddLink(buffer, page.text(i), page.textLength(i), i, icons[page.types[i]], links);
+			}
+		});
+		g_object_unref(buffer);
+	}
+	{
+		auto buffer = gtk_text_buffer_new(0);
+		BufferStyle style;
+		style.icon = gtk_text_buffer_create_tag(buffer, "icon", "rise", -7 * PANGO_SCALE, "rise-set", true, nullptr);
+		style.link = gtk_text_buffer_create_tag(buffer, "link", "underline", true, "foreground-rgba", &blue, nullptr);
+		style.icons = icons;
+		std::vector<Link> links;
+		fill("appendItems", page, [&](size_t from, size_t to){
+			appendItems(buffer, style, page, from, to, links);
+		});
+		g_object_unref(buffer);
+	}
+	g_object_unref(icons[TYPE_DIR]);
+	return 0;
+}
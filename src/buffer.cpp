@@ -0,0 +1,38 @@
+#include <mutex>
+#include <vector>
+#include "buffer.h"
+
+const size_t MAX_FREE_BUFFERS = 64;
+
+std::mutex bufferMtx;
+std::vector<Buffer*> freeBuffers;
+
+BufferRef allocBuffer()
+{
+	Buffer* b = 0;
+	{
+		std::unique_lock<std::mutex> lock(bufferMtx);
+		if(freeBuffers.size())
+		{
+			b = freeBuffers.back();
+			freeBuffers.pop_back();
+		}
+	}
+	if(!b)
+		b = new Buffer;
+	b->refs = 1;
+	return BufferRef(b);
+}
+
+void releaseBuffer(Buffer* b)
+{
+	{
+		std::unique_lock<std::mutex> lock(bufferMtx);
+		if(freeBuffers.size() < MAX_FREE_BUFFERS)
+		{
+			freeBuffers.push_back(b);
+			return;
+		}
+	}
+	delete b;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+const size_t BUFFER_SIZE = 0x10000;
+
+// A pooled receive buffer. The worker receives into it and hands slices of
+// it to the UI without copying; it goes back to the pool once the last
+// reference to it is dropped.
+struct Buffer
+{
+	std::atomic<int> refs;
+	char data[BUFFER_SIZE];
+};
+
+void releaseBuffer(Buffer* b);
+
+struct BufferRef
+{
+	Buffer* buffer;
+
+	BufferRef() : buffer(0) {}
+	explicit BufferRef(Buffer* b) : buffer(b) {}
+	BufferRef(const BufferRef& r) : buffer(r.buffer) { if(buffer) ++buffer->refs; }
+	BufferRef(BufferRef&& r) : buffer(r.buffer) { r.buffer = 0; }
+	~BufferRef() { reset(); }
+
+	BufferRef& operator=(BufferRef r)
+	{
+		std::swap(buffer, r.buffer);
+		return *this;
+	}
+
+	void reset()
+	{
+		if(buffer && --buffer->refs == 0)
+			releaseBuffer(buffer);
+		buffer = 0;
+	}
+
+	char* data() const { return buffer->data; }
+	explicit operator bool() const { return buffer != 0; }
+};
+
+// A filled-in region of a buffer.
+struct Slice
+{
+	BufferRef buffer;
+	size_t offset;
+	size_t size;
+
+	Slice() : offset(0), size(0) {}
+	Slice(const BufferRef& buffer, size_t offset, size_t size) : buffer(buffer), offset(offset), size(size) {}
+
+	const char* data() const { return buffer.data() + offset; }
+};
+
+BufferRef allocBuffer();
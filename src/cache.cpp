@@ -0,0 +1,50 @@
+#include "cache.h"
+
+std::shared_ptr<Page> PageCache::get(const std::string& url)
+{
+	auto i = index.find(url);
+	if(i == index.end())
+	{
+		++misses;
+		return 0;
+	}
+	++hits;
+	entries.splice(entries.begin(), entries, i->second);
+	return i->second->second;
+}
+
+void PageCache::put(const std::string& url, const std::shared_ptr<Page>& page)
+{
+	remove(url);
+	size_t size = page->memory();
+	if(size > budget)
+		return;
+	while(used + size > budget && entries.size())
+	{
+		auto& last = entries.back();
+		used -= last.second->memory();
+		index.erase(last.first);
+		entries.pop_back();
+		++evictions;
+	}
+	entries.push_front(Entry(url, page));
+	index[url] = entries.begin();
+	used += size;
+}
+
+void PageCache::remove(const std::string& url)
+{
+	auto i = index.find(url);
+	if(i == index.end())
+		return;
+	used -= i->second->second->memory();
+	entries.erase(i->second);
+	index.erase(i);
+}
+
+void PageCache::clear()
+{
+	entries.clear();
+	index.clear();
+	used = 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "gopher.h"
+
+// In-memory LRU cache of finished pages, bounded by the memory the pages
+// use and keyed by normalized url.
+struct PageCache
+{
+	typedef std::pair<std::string, std::shared_ptr<Page>> Entry;
+
+	size_t budget;
+	size_t used;
+	size_t hits;
+	size_t misses;
+	size_t evictions;
+	std::list<Entry> entries;
+	std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+	PageCache(size_t budget) : budget(budget), used(0), hits(0), misses(0), evictions(0) {}
+
+	std::shared_ptr<Page> get(const std::string& url);
+	void put(const std::string& url, const std::shared_ptr<Page>& page);
+	void remove(const std::string& url);
+	void clear();
+};
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "diskcache.h"
+
+const char CACHE_MAGIC[4] = { 'F', 'R', 'C', '1' };
+
+struct CacheHeader
+{
+	char magic[4];
+	uint32_t urlLength;
+	int64_t stored;
+	uint64_t size;
+};
+
+std::string cacheName(const std::string& url)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for(unsigned char c : url)
+	{
+		hash ^= c;
+		hash *= 0x100000001b3ull;
+	}
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+	return name;
+}
+
+CachedFile::~CachedFile()
+{
+	if(map)
+		munmap(map, mapSize);
+}
+
+bool DiskCache::open()
+{
+	const char* xdg = getenv("XDG_CACHE_HOME");
+	if(xdg && *xdg)
+		dir = xdg;
+	else if(getenv("HOME"))
+		dir = std::string(getenv("HOME")) + "/.cache";
+	else
+		return false;
+	mkdir(dir.c_str(), 0700);
+	dir += "/ferret";
+	if(mkdir(dir.c_str(), 0700) == -1 && errno != EEXIST)
+	{
+		std::cerr << "Could not create cache directory " << dir << ": " << strerror(errno) << "\n";
+		dir.clear();
+		return false;
+	}
+
+	DIR* d = opendir(dir.c_str());
+	if(!d)
+		return false;
+	while(dirent* e = readdir(d))
+	{
+		std::string name = e->d_name;
+		if(name.find('.') != std::string::npos)
+		{
+			// left over from an interrupted write
+			if(name.size() > 5 && name.compare(name.size()-5, 5, ".part") == 0)
+				unlink(path(name).c_str());
+			continue;
+		}
+		struct stat st;
+		if(stat(path(name).c_str(), &st) == -1 || !S_ISREG(st.st_mode))
+			continue;
+		entries[name] = { size_t(st.st_size), st.st_mtime };
+		used += st.st_size;
+	}
+	closedir(d);
+	evict();
+	return true;
+}
+
+std::unique_ptr<CachedFile> DiskCache::get(const std::string& url)
+{
+	std::unique_ptr<CachedFile> file;
+	std::string name = cacheName(url);
+	if(dir.empty() || !entries.count(name))
+		return file;
+
+	int fd = ::open(path(name).c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd == -1)
+		return file;
+	struct stat st;
+	if(fstat(fd, &st) == -1 || size_t(st.st_size) < sizeof(CacheHeader))
+	{
+		close(fd);
+		return file;
+	}
+	void* map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+		return file;
+
+	file.reset(new CachedFile);
+	file->map = map;
+	file->mapSize = st.st_size;
+	CacheHeader header;
+	memcpy(&header, map, sizeof(header));
+	const char* body = static_cast<const char*>(map) + sizeof(header);
+	if(memcmp(header.magic, CACHE_MAGIC, 4) || sizeof(header) + header.urlLength + header.size != file->mapSize
+		|| url.compare(0, std::string::npos, body, header.urlLength))
+	{
+		file.reset();
+		return file;
+	}
+	file->data = body + header.urlLength;
+	file->size = header.size;
+	file->stored = header.stored;
+
+	utimensat(AT_FDCWD, path(name).c_str(), 0, 0);
+	entries[name].used = time(0);
+	return file;
+}
+
+void DiskCache::put(const std::string& url, const char* data, size_t size)
+{
+	if(dir.empty() || sizeof(CacheHeader) + url.size() + size > budget)
+		return;
+	std::string name = cacheName(url);
+	std::string tmp = path(name + ".part");
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if(fd == -1)
+		return;
+
+	CacheHeader header;
+	memcpy(header.magic, CACHE_MAGIC, 4);
+	header.urlLength = url.size();
+	header.stored = time(0);
+	header.size = size;
+	bool ok = write(fd, &header, sizeof(header)) == ssize_t(sizeof(header))
+		&& write(fd, url.data(), url.size()) == ssize_t(url.size());
+	while(ok && size)
+	{
+		ssize_t w = write(fd, data, size);
+		ok = w > 0;
+		if(ok)
+		{
+			data += w;
+			size -= w;
+		}
+	}
+	close(fd);
+	if(!ok || rename(tmp.c_str(), path(name).c_str()) == -1)
+	{
+		unlink(tmp.c_str());
+		return;
+	}
+
+	auto old = entries.find(name);
+	if(old != entries.end())
+		used -= old->second.size;
+	size_t total = sizeof(header) + header.urlLength + header.size;
+	entries[name] = { total, header.stored };
+	used += total;
+	evict();
+}
+
+void DiskCache::evict()
+{
+	if(used <= budget)
+		return;
+	std::vector<std::pair<time_t, std::string>> byAge;
+	for(auto& e : entries)
+		byAge.push_back(std::make_pair(e.second.used, e.first));
+	std::sort(byAge.begin(), byAge.end());
+	for(auto& e : byAge)
+	{
+		if(used <= budget)
+			break;
+		unlink(path(e.second).c_str());
+		used -= entries[e.second].size;
+		entries.erase(e.second);
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// A cache entry mapped into memory.
+struct CachedFile
+{
+	void* map;
+	size_t mapSize;
+	const char* data;
+	size_t size;
+	time_t stored;
+
+	CachedFile() : map(0), mapSize(0), data(0), size(0), stored(0) {}
+	~CachedFile();
+};
+
+// Persistent cache of page bytes under $XDG_CACHE_HOME/ferret. Each entry
+// is one file named after a hash of the normalized url, holding a header,
+// the url and the bytes. A file's mtime records when it was last used and
+// drives LRU eviction once the cache grows past its budget.
+struct DiskCache
+{
+	struct Entry
+	{
+		size_t size;
+		time_t used;
+	};
+
+	std::string dir;
+	size_t budget;
+	size_t used;
+	std::unordered_map<std::string, Entry> entries;
+
+	DiskCache(size_t budget) : budget(budget), used(0) {}
+
+	bool open();
+	std::unique_ptr<CachedFile> get(const std::string& url);
+	void put(const std::string& url, const char* data, size_t size);
+
+private:
+	std::string path(const std::string& name) const { return dir + "/" + name; }
+	void evict();
+};
@@ -0,0 +1,474 @@
+#include "docview.h"
+#include <algorithm>
+
+const int MARGIN = 20;
+const size_t OVERSCAN = 32;
+const size_t npos = size_t(-1);
+
+DocView::DocView(GdkPixbuf** icons) : icons(icons), finder(0), menu(false), lineHeight(0), textHeight(0), iconWidth(0),
+	spacerWidth(0), maxWidth(0), anchor({0, 0}), cursor({0, 0}), selecting(false), pressed(npos), hovered(npos)
+{
+	vadjust = gtk_adjustment_new(0, 0, 0, 0, 0, 0);
+	hadjust = gtk_adjustment_new(0, 0, 0, 0, 0, 0);
+	area = gtk_drawing_area_new();
+	gtk_widget_set_can_focus(area, true);
+	gtk_widget_add_events(area, GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK | GDK_POINTER_MOTION_MASK
+		| GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK | GDK_KEY_PRESS_MASK);
+	gtk_style_context_add_class(gtk_widget_get_style_context(area), "document");
+
+	auto row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+	gtk_box_pack_start(GTK_BOX(row), area, true, true, 0);
+	gtk_box_pack_start(GTK_BOX(row), gtk_scrollbar_new(GTK_ORIENTATION_VERTICAL, vadjust), false, false, 0);
+	handle = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+	gtk_box_pack_start(GTK_BOX(handle), row, true, true, 0);
+	gtk_box_pack_start(GTK_BOX(handle), gtk_scrollbar_new(GTK_ORIENTATION_HORIZONTAL, hadjust), false, false, 0);
+
+	hand = gdk_cursor_new_from_name(gdk_display_get_default(), "pointer");
+	linkAttrs = pango_attr_list_new();
+	pango_attr_list_insert(linkAttrs, pango_attr_underline_new(PANGO_UNDERLINE_SINGLE));
+	pango_attr_list_insert(linkAttrs, pango_attr_foreground_new(0, 0, 0xffff));
+
+	g_signal_connect(area, "draw", G_CALLBACK(_static_draw), this);
+	g_signal_connect(area, "button-press-event", G_CALLBACK(_static_press), this);
+	g_signal_connect(area, "button-release-event", G_CALLBACK(_static_release), this);
+	g_signal_connect(area, "motion-notify-event", G_CALLBACK(_static_motion), this);
+	g_signal_connect(area, "scroll-event", G_CALLBACK(_static_scroll), this);
+	g_signal_connect(area, "key-press-event", G_CALLBACK(_static_key), this);
+	g_signal_connect(area, "size-allocate", G_CALLBACK(_static_allocate), this);
+	g_signal_connect(area, "style-updated", G_CALLBACK(_static_style), this);
+	g_signal_connect(vadjust, "value-changed", G_CALLBACK(_static_scrolled), this);
+	g_signal_connect(hadjust, "value-changed", G_CALLBACK(_static_scrolled), this);
+}
+
+DocView::~DocView()
+{
+	resetLayouts();
+	pango_attr_list_unref(linkAttrs);
+	if(hand)
+		g_object_unref(hand);
+}
+
+void DocView::setPage(const std::shared_ptr<Page>& page, bool m)
+{
+	clear();
+	_page = page;
+	menu = m;
+	lineHeight = 0;
+	update();
+}
+
+void DocView::update()
+{
+	configure();
+	gtk_widget_queue_draw(area);
+}
+
+void DocView::clear()
+{
+	_page.reset();
+	resetLayouts();
+	maxWidth = 0;
+	anchor = cursor = {0, 0};
+	selecting = false;
+	pressed = npos;
+	hovered = npos;
+	gtk_adjustment_set_value(vadjust, 0);
+	gtk_adjustment_set_value(hadjust, 0);
+	configure();
+	gtk_widget_queue_draw(area);
+}
+
+void DocView::scrollTo(size_t line)
+{
+	measure();
+	double height = gtk_widget_get_allocated_height(area);
+	double y = double(line) * lineHeight - (height - lineHeight) / 2;
+	double top = gtk_adjustment_get_upper(vadjust) - height;
+	gtk_adjustment_set_value(vadjust, std::max(0.0, std::min(y, top)));
+}
+
+void DocView::setFinder(const Finder* f)
+{
+	finder = f;
+	gtk_widget_queue_draw(area);
+}
+
+void DocView::visibleRange(size_t& first, size_t& last)
+{
+	first = last = 0;
+	if(!_page || !lineHeight)
+		return;
+	double top = gtk_adjustment_get_value(vadjust);
+	first = std::min(size_t(top / lineHeight), _page->size());
+	last = std::min(size_t((top + gtk_widget_get_allocated_height(area)) / lineHeight) + 1, _page->size());
+}
+
+std::string DocView::selection()
+{
+	std::string text;
+	if(!_page || (anchor.line == cursor.line && anchor.index == cursor.index))
+		return text;
+	size_t first = std::min(anchor.line, cursor.line);
+	size_t last = std::max(anchor.line, cursor.line);
+	for(size_t i = first; i <= last && i < _page->size(); ++i)
+	{
+		int start, end;
+		lineSelection(i, start, end);
+		if(i != first)
+			text += '\n';
+		text.append(_page->text(i) + start, end - start);
+	}
+	return text;
+}
+
+void DocView::measure()
+{
+	if(lineHeight)
+		return;
+	auto l = gtk_widget_create_pango_layout(area, "Xg");
+	pango_layout_get_pixel_size(l, 0, &textHeight);
+	pango_layout_set_text(l, "    ", -1);
+	pango_layout_get_pixel_size(l, &spacerWidth, 0);
+	g_object_unref(l);
+	lineHeight = std::max(textHeight, 1);
+	iconWidth = 0;
+	if(menu && icons[TYPE_DIR])
+	{
+		iconWidth = gdk_pixbuf_get_width(icons[TYPE_DIR]);
+		lineHeight = std::max(lineHeight, gdk_pixbuf_get_height(icons[TYPE_DIR]));
+	}
+}
+
+void DocView::configure()
+{
+	measure();
+	double width = gtk_widget_get_allocated_width(area);
+	double height = gtk_widget_get_allocated_height(area);
+	double lines = _page ? _page->size() : 0;
+	double upper = std::max(lines * lineHeight + MARGIN, height);
+	double value = std::min(gtk_adjustment_get_value(vadjust), upper - height);
+	gtk_adjustment_configure(vadjust, value, 0, upper, lineHeight * 3, height * 0.9, height);
+	upper = std::max(double(maxWidth), width);
+	value = std::min(gtk_adjustment_get_value(hadjust), upper - width);
+	gtk_adjustment_configure(hadjust, value, 0, upper, lineHeight * 3, width * 0.9, width);
+}
+
+void DocView::resetLayouts()
+{
+	for(auto& l : layouts)
+		g_object_unref(l.second);
+	layouts.clear();
+}
+
+PangoLayout* DocView::layout(size_t line)
+{
+	auto i = layouts.find(line);
+	if(i != layouts.end())
+		return i->second;
+	auto l = gtk_widget_create_pango_layout(area, 0);
+	pango_layout_set_text(l, _page->text(line), _page->textLength(line));
+	if(isLink(line))
+		pango_layout_set_attributes(l, linkAttrs);
+	int width;
+	pango_layout_get_pixel_size(l, &width, 0);
+	if(textX(line) + width + MARGIN > maxWidth)
+	{
+		maxWidth = textX(line) + width + MARGIN;
+		configure();
+	}
+	layouts[line] = l;
+	return l;
+}
+
+bool DocView::isLink(size_t line) const
+{
+	return _page->types[line] != TYPE_INFO;
+}
+
+int DocView::textX(size_t line) const
+{
+	if(!isLink(line))
+		return MARGIN;
+	return MARGIN + (icons[_page->types[line]] ? iconWidth : 0) + spacerWidth;
+}
+
+DocView::Position DocView::position(double x, double y)
+{
+	Position p = {0, 0};
+	if(!_page || !_page->size())
+		return p;
+	y += gtk_adjustment_get_value(vadjust);
+	p.line = y < 0 ? 0 : std::min(size_t(y / lineHeight), _page->size() - 1);
+	x += gtk_adjustment_get_value(hadjust) - textX(p.line);
+	if(x <= 0)
+		return p;
+	int index, trailing;
+	pango_layout_xy_to_index(layout(p.line), int(x * PANGO_SCALE), textHeight / 2 * PANGO_SCALE, &index, &trailing);
+	const char* text = _page->text(p.line);
+	p.index = g_utf8_offset_to_pointer(text + index, trailing) - text;
+	p.index = std::min(p.index, int(_page->textLength(p.line)));
+	return p;
+}
+
+size_t DocView::linkAt(double x, double y)
+{
+	if(!_page)
+		return npos;
+	y += gtk_adjustment_get_value(vadjust);
+	if(y < 0 || y >= double(_page->size()) * lineHeight)
+		return npos;
+	size_t line = size_t(y / lineHeight);
+	if(!isLink(line) || !_page->hasUrl(line))
+		return npos;
+	x += gtk_adjustment_get_value(hadjust) - textX(line);
+	int width;
+	pango_layout_get_pixel_size(layout(line), &width, 0);
+	if(x < 0 || x >= width)
+		return npos;
+	return line;
+}
+
+// The selected byte range of one line.
+void DocView::lineSelection(size_t line, int& start, int& end)
+{
+	Position a = anchor, b = cursor;
+	if(b.line < a.line || (b.line == a.line && b.index < a.index))
+		std::swap(a, b);
+	start = end = 0;
+	if(line < a.line || line > b.line)
+		return;
+	start = line == a.line ? a.index : 0;
+	end = line == b.line ? b.index : int(_page->textLength(line));
+}
+
+void DocView::copy()
+{
+	std::string text = selection();
+	if(text.size())
+		gtk_clipboard_set_text(gtk_clipboard_get(GDK_SELECTION_CLIPBOARD), text.data(), text.size());
+}
+
+void DocView::draw(cairo_t* cr)
+{
+	int width = gtk_widget_get_allocated_width(area);
+	int height = gtk_widget_get_allocated_height(area);
+	auto style = gtk_widget_get_style_context(area);
+	gtk_render_background(style, cr, 0, 0, width, height);
+	if(!_page || !_page->size())
+		return;
+	measure();
+
+	double top = gtk_adjustment_get_value(vadjust);
+	double left = gtk_adjustment_get_value(hadjust);
+	size_t first = size_t(top / lineHeight);
+	size_t last = std::min(_page->size(), size_t((top + height) / lineHeight) + 1);
+
+	GdkRGBA fg;
+	gtk_style_context_get_color(style, gtk_widget_get_state_flags(area), &fg);
+	size_t match = finder ? finder->firstFrom(first) : 0;
+	for(size_t i = first; i < last; ++i)
+	{
+		double y = double(i) * lineHeight - top;
+		double x = textX(i) - left;
+		auto l = layout(i);
+
+		int start, end;
+		lineSelection(i, start, end);
+		if(start != end)
+		{
+			PangoRectangle a, b;
+			pango_layout_index_to_pos(l, start, &a);
+			pango_layout_index_to_pos(l, end, &b);
+			cairo_set_source_rgb(cr, 0.7, 0.8, 1.0);
+			cairo_rectangle(cr, x + a.x / PANGO_SCALE, y, (b.x - a.x) / PANGO_SCALE, lineHeight);
+			cairo_fill(cr);
+		}
+
+		for(; finder && match < finder->matches.size() && finder->matches[match].item == i; ++match)
+		{
+			PangoRectangle a, b;
+			pango_layout_index_to_pos(l, finder->matches[match].start, &a);
+			pango_layout_index_to_pos(l, finder->matches[match].start + finder->needle.size(), &b);
+			if(match == finder->current)
+				cairo_set_source_rgb(cr, 1.0, 0.6, 0.2);
+			else
+				cairo_set_source_rgb(cr, 1.0, 1.0, 0.4);
+			cairo_rectangle(cr, x + a.x / PANGO_SCALE, y, (b.x - a.x) / PANGO_SCALE, lineHeight);
+			cairo_fill(cr);
+		}
+
+		auto icon = isLink(i) ? icons[_page->types[i]] : 0;
+		if(icon)
+		{
+			double iy = y + (lineHeight - gdk_pixbuf_get_height(icon)) / 2;
+			gdk_cairo_set_source_pixbuf(cr, icon, MARGIN - left, iy);
+			cairo_rectangle(cr, MARGIN - left, iy, gdk_pixbuf_get_width(icon), gdk_pixbuf_get_height(icon));
+			cairo_fill(cr);
+		}
+
+		gdk_cairo_set_source_rgba(cr, &fg);
+		cairo_move_to(cr, x, y + (lineHeight - textHeight) / 2);
+		pango_cairo_show_layout(cr, l);
+	}
+
+	// lay out the overscan lines so short scrolls find them ready, and
+	// drop everything further away
+	size_t from = first > OVERSCAN ? first - OVERSCAN : 0;
+	size_t to = std::min(_page->size(), last + OVERSCAN);
+	for(size_t i = from; i < to; ++i)
+		layout(i);
+	for(auto i = layouts.begin(); i != layouts.end();)
+	{
+		if(i->first < from || i->first >= to)
+		{
+			g_object_unref(i->second);
+			i = layouts.erase(i);
+		}
+		else
+			++i;
+	}
+}
+
+void DocView::press(GdkEventButton* event)
+{
+	if(event->button != 1 || event->type != GDK_BUTTON_PRESS)
+		return;
+	gtk_widget_grab_focus(area);
+	pressed = linkAt(event->x, event->y);
+	cursor = position(event->x, event->y);
+	if(!(event->state & GDK_SHIFT_MASK))
+		anchor = cursor;
+	selecting = true;
+	gtk_widget_queue_draw(area);
+}
+
+void DocView::release(GdkEventButton* event)
+{
+	if(event->button != 1)
+		return;
+	selecting = false;
+	size_t link = pressed;
+	pressed = npos;
+	bool dragged = anchor.line != cursor.line || anchor.index != cursor.index;
+	if(link != npos && !dragged && linkAt(event->x, event->y) == link)
+		_activate(link);
+}
+
+void DocView::motion(GdkEventMotion* event)
+{
+	if(selecting && (event->state & GDK_BUTTON1_MASK))
+	{
+		cursor = position(event->x, event->y);
+		gtk_widget_queue_draw(area);
+	}
+	size_t link = linkAt(event->x, event->y);
+	if(link != hovered)
+	{
+		hovered = link;
+		gdk_window_set_cursor(gtk_widget_get_window(area), link != npos ? hand : 0);
+		_hover(link);
+	}
+}
+
+void DocView::scroll(GdkEventScroll* event)
+{
+	double dy = 0;
+	if(event->direction == GDK_SCROLL_UP)
+		dy = -3;
+	else if(event->direction == GDK_SCROLL_DOWN)
+		dy = 3;
+	else if(event->direction == GDK_SCROLL_SMOOTH)
+		dy = event->delta_y * 3;
+	double top = gtk_adjustment_get_upper(vadjust) - gtk_adjustment_get_page_size(vadjust);
+	double value = gtk_adjustment_get_value(vadjust) + dy * lineHeight;
+	gtk_adjustment_set_value(vadjust, std::max(0.0, std::min(value, top)));
+}
+
+bool DocView::key(GdkEventKey* event)
+{
+	if(!_page)
+		return false;
+	if(event->state & GDK_CONTROL_MASK)
+	{
+		if(event->keyval == GDK_KEY_c)
+			copy();
+		else if(event->keyval == GDK_KEY_a && _page->size())
+		{
+			anchor = {0, 0};
+			cursor = {_page->size() - 1, int(_page->textLength(_page->size() - 1))};
+			gtk_widget_queue_draw(area);
+		}
+		else
+			return false;
+		return true;
+	}
+	double value = gtk_adjustment_get_value(vadjust);
+	double page = gtk_adjustment_get_page_size(vadjust);
+	double top = gtk_adjustment_get_upper(vadjust) - page;
+	switch(event->keyval)
+	{
+	case GDK_KEY_Up: value -= lineHeight; break;
+	case GDK_KEY_Down: value += lineHeight; break;
+	case GDK_KEY_Page_Up: value -= page * 0.9; break;
+	case GDK_KEY_Page_Down: value += page * 0.9; break;
+	case GDK_KEY_Home: value = 0; break;
+	case GDK_KEY_End: value = top; break;
+	default: return false;
+	}
+	gtk_adjustment_set_value(vadjust, std::max(0.0, std::min(value, top)));
+	return true;
+}
+
+gboolean DocView::_static_draw(GtkWidget* w, cairo_t* cr, gpointer d)
+{
+	reinterpret_cast<DocView*>(d)->draw(cr);
+	return true;
+}
+
+gboolean DocView::_static_press(GtkWidget* w, GdkEventButton* e, gpointer d)
+{
+	reinterpret_cast<DocView*>(d)->press(e);
+	return true;
+}
+
+gboolean DocView::_static_release(GtkWidget* w, GdkEventButton* e, gpointer d)
+{
+	reinterpret_cast<DocView*>(d)->release(e);
+	return true;
+}
+
+gboolean DocView::_static_motion(GtkWidget* w, GdkEventMotion* e, gpointer d)
+{
+	reinterpret_cast<DocView*>(d)->motion(e);
+	return true;
+}
+
+gboolean DocView::_static_scroll(GtkWidget* w, GdkEventScroll* e, gpointer d)
+{
+	reinterpret_cast<DocView*>(d)->scroll(e);
+	return true;
+}
+
+gboolean DocView::_static_key(GtkWidget* w, GdkEventKey* e, gpointer d)
+{
+	return reinterpret_cast<DocView*>(d)->key(e);
+}
+
+void DocView::_static_allocate(GtkWidget* w, GdkRectangle* r, gpointer d)
+{
+	reinterpret_cast<DocView*>(d)->configure();
+}
+
+void DocView::_static_style(GtkWidget* w, gpointer d)
+{
+	auto v = reinterpret_cast<DocView*>(d);
+	v->lineHeight = 0;
+	v->maxWidth = 0;
+	v->resetLayouts();
+	v->update();
+}
+
+void DocView::_static_scrolled(GtkAdjustment* a, gpointer d)
+{
+	gtk_widget_queue_draw(reinterpret_cast<DocView*>(d)->area);
+}
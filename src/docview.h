@@ -0,0 +1,97 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include "find.h"
+#include "gopher.h"
+#include "ui.h"
+
+// Draws a page straight from its item records instead of copying it into a
+// GtkTextBuffer. Every item is one line and all lines have the same height,
+// so the page's textStarts double as the line index: any line's position is
+// known without layout. Only the lines on screen, plus OVERSCAN either side,
+// have a PangoLayout at any time, and only their find matches are
+// highlighted. Hovering a link reports its item, or size_t(-1) when the
+// pointer leaves it.
+class DocView : public Widget
+{
+public:
+	struct Position
+	{
+		size_t line;
+		int index;
+	};
+
+	DocView(GdkPixbuf** icons);
+	~DocView();
+
+	const std::shared_ptr<Page>& page() const { return _page; }
+	GtkAdjustment* adjustment() const { return vadjust; }
+
+	void setPage(const std::shared_ptr<Page>& page, bool menu);
+	void update();
+	void clear();
+	void scrollTo(size_t line);
+	// highlights finder's matches until set to 0
+	void setFinder(const Finder* finder);
+	std::string selection();
+	void visibleRange(size_t& first, size_t& last);
+
+	template <class F> void onActivate(const F& f) { _activate = f; }
+	template <class F> void onHover(const F& f) { _hover = f; }
+
+private:
+	GtkWidget* area;
+	GtkAdjustment* vadjust;
+	GtkAdjustment* hadjust;
+	GdkPixbuf** icons;
+	GdkCursor* hand;
+	PangoAttrList* linkAttrs;
+
+	std::shared_ptr<Page> _page;
+	const Finder* finder;
+	bool menu;
+	int lineHeight;
+	int textHeight;
+	int iconWidth;
+	int spacerWidth;
+	int maxWidth;
+	std::map<size_t, PangoLayout*> layouts;
+
+	Position anchor, cursor;
+	bool selecting;
+	size_t pressed;
+	size_t hovered;
+	std::function<void(size_t)> _activate = [](size_t){};
+	std::function<void(size_t)> _hover = [](size_t){};
+
+	void measure();
+	void configure();
+	void resetLayouts();
+	PangoLayout* layout(size_t line);
+	bool isLink(size_t line) const;
+	int textX(size_t line) const;
+	Position position(double x, double y);
+	size_t linkAt(double x, double y);
+	void lineSelection(size_t line, int& start, int& end);
+	void copy();
+
+	void draw(cairo_t* cr);
+	void press(GdkEventButton* event);
+	void release(GdkEventButton* event);
+	void motion(GdkEventMotion* event);
+	void scroll(GdkEventScroll* event);
+	bool key(GdkEventKey* event);
+
+	static gboolean _static_draw(GtkWidget* w, cairo_t* cr, gpointer d);
+	static gboolean _static_press(GtkWidget* w, GdkEventButton* e, gpointer d);
+	static gboolean _static_release(GtkWidget* w, GdkEventButton* e, gpointer d);
+	static gboolean _static_motion(GtkWidget* w, GdkEventMotion* e, gpointer d);
+	static gboolean _static_scroll(GtkWidget* w, GdkEventScroll* e, gpointer d);
+	static gboolean _static_key(GtkWidget* w, GdkEventKey* e, gpointer d);
+	static void _static_allocate(GtkWidget* w, GdkRectangle* r, gpointer d);
+	static void _static_style(GtkWidget* w, gpointer d);
+	static void _static_scrolled(GtkAdjustment* a, gpointer d);
+};
@@ -0,0 +1,45 @@
+#include "fd.h"
+#include <atomic>
+#include <unistd.h>
+
+std::atomic<size_t> descriptors(0);
+
+UniqueFd::UniqueFd(int fd) : fd(fd)
+{
+	if(fd != -1)
+		++descriptors;
+}
+
+UniqueFd& UniqueFd::operator=(UniqueFd&& o)
+{
+	if(this != &o)
+	{
+		close();
+		fd = o.fd;
+		o.fd = -1;
+	}
+	return *this;
+}
+
+int UniqueFd::close()
+{
+	if(fd == -1)
+		return 0;
+	int r = ::close(fd);
+	fd = -1;
+	--descriptors;
+	return r;
+}
+
+void UniqueFd::reset(int f)
+{
+	close();
+	fd = f;
+	if(fd != -1)
+		++descriptors;
+}
+
+size_t openDescriptors()
+{
+	return descriptors;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+// Owns a file descriptor and closes it when destroyed or reset. All
+// descriptors the worker opens are held by one of these, and
+// openDescriptors() counts how many are open, so a leak shows up as a
+// count that never returns to zero.
+class UniqueFd
+{
+public:
+	UniqueFd() : fd(-1) {}
+	explicit UniqueFd(int fd);
+	UniqueFd(UniqueFd&& o) : fd(o.fd) { o.fd = -1; }
+	UniqueFd& operator=(UniqueFd&& o);
+	UniqueFd(const UniqueFd&) = delete;
+	UniqueFd& operator=(const UniqueFd&) = delete;
+	~UniqueFd() { close(); }
+
+	int get() const { return fd; }
+	bool valid() const { return fd != -1; }
+
+	// Closes the descriptor, returning close()'s result.
+	int close();
+	void reset(int f = -1);
+
+private:
+	int fd;
+};
+
+size_t openDescriptors();
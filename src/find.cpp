@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#include "find.h"
+#include "scan.h"
+
+namespace
+{
+	inline unsigned char fold(unsigned char c)
+	{
+		return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+	}
+
+	// ORed into text bytes before comparing with c, so both cases of a
+	// letter compare equal to it and nothing else does
+	inline unsigned char caseBit(unsigned char c, bool ignoreCase)
+	{
+		c = fold(c);
+		return ignoreCase && c >= 'a' && c <= 'z' ? 0x20 : 0;
+	}
+
+	bool equal(const char* a, const char* b, size_t n, bool ignoreCase)
+	{
+		if(!ignoreCase)
+			return memcmp(a, b, n) == 0;
+		for(size_t i = 0; i < n; ++i)
+		{
+			if(fold(a[i]) != fold(b[i]))
+				return false;
+		}
+		return true;
+	}
+
+	size_t findPortable(const char* data, size_t size, const char* needle, size_t length, bool ignoreCase)
+	{
+		if(length > size)
+			return size;
+		if(!ignoreCase)
+		{
+			for(const char* p = data; (p = static_cast<const char*>(memchr(p, needle[0], data + size - length + 1 - p)));)
+			{
+				if(memcmp(p, needle, length) == 0)
+					return p - data;
+				++p;
+			}
+			return size;
+		}
+		unsigned char first = fold(needle[0]);
+		for(size_t i = 0; i + length <= size; ++i)
+		{
+			if(fold(data[i]) == first && equal(data + i, needle, length, true))
+				return i;
+		}
+		return size;
+	}
+
+#ifdef __SSE2__
+	size_t findSse2(const char* data, size_t size, const char* needle, size_t length, bool ignoreCase)
+	{
+		const __m128i firstBit = _mm_set1_epi8(caseBit(needle[0], ignoreCase));
+		const __m128i lastBit = _mm_set1_epi8(caseBit(needle[length-1], ignoreCase));
+		const __m128i first = _mm_or_si128(_mm_set1_epi8(needle[0]), firstBit);
+		const __m128i last = _mm_or_si128(_mm_set1_epi8(needle[length-1]), lastBit);
+		size_t i = 0;
+		for(; i + length - 1 + 16 <= size; i += 16)
+		{
+			__m128i a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), firstBit);
+			__m128i b = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + length - 1)), lastBit);
+			unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+			for(; mask; mask &= mask - 1)
+			{
+				size_t at = i + __builtin_ctz(mask);
+				if(equal(data + at, needle, length, ignoreCase))
+					return at;
+			}
+		}
+		return i + findPortable(data + i, size - i, needle, length, ignoreCase);
+	}
+
+	__attribute__((target("avx2")))
+	size_t findAvx2(const char* data, size_t size, const char* needle, size_t length, bool ignoreCase)
+	{
+		const __m256i firstBit = _mm256_set1_epi8(caseBit(needle[0], ignoreCase));
+		const __m256i lastBit = _mm256_set1_epi8(caseBit(needle[length-1], ignoreCase));
+		const __m256i first = _mm256_or_si256(_mm256_set1_epi8(needle[0]), firstBit);
+		const __m256i last = _mm256_or_si256(_mm256_set1_epi8(needle[length-1]), lastBit);
+		size_t i = 0;
+		for(; i + length - 1 + 32 <= size; i += 32)
+		{
+			__m256i a = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), firstBit);
+			__m256i b = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + length - 1)), lastBit);
+			unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+			for(; mask; mask &= mask - 1)
+			{
+				size_t at = i + __builtin_ctz(mask);
+				if(equal(data + at, needle, length, ignoreCase))
+					return at;
+			}
+		}
+		return i + findSse2(data + i, size - i, needle, length, ignoreCase);
+	}
+#endif
+}
+
+size_t findBytes(const char* data, size_t size, const char* needle, size_t length, bool ignoreCase)
+{
+	if(!length)
+		return 0;
+	if(length > size)
+		return size;
+#ifdef __SSE2__
+	static const bool avx2 = cpuHasAvx2();
+	if(avx2)
+		return findAvx2(data, size, needle, length, ignoreCase);
+	return findSse2(data, size, needle, length, ignoreCase);
+#else
+	return findPortable(data, size, needle, length, ignoreCase);
+#endif
+}
+
+void findInPage(const Page& page, const std::string& needle, bool ignoreCase, size_t from, std::vector<FindMatch>& matches)
+{
+	size_t n = page.size();
+	if(needle.empty() || from >= n)
+		return;
+	const char* data = page.bytes.data();
+	size_t pos = page.textStarts[from];
+	size_t end = page.textStarts[n-1] + page.textLengths[n-1];
+	size_t item = from;
+	while(pos < end)
+	{
+		size_t at = pos + findBytes(data + pos, end - pos, needle.data(), needle.size(), ignoreCase);
+		if(at >= end)
+			break;
+		while(item + 1 < n && page.textStarts[item+1] <= at)
+			++item;
+		// hits in paths and host names, or running past the text, don't count
+		if(at + needle.size() <= page.textStarts[item] + page.textLengths[item])
+		{
+			matches.push_back({uint32_t(item), uint32_t(at - page.textStarts[item])});
+			pos = at + needle.size();
+		}
+		else
+			pos = at + 1;
+	}
+}
+
+void Finder::start(const std::string& n, bool i)
+{
+	needle = n;
+	ignoreCase = i;
+	restart();
+}
+
+void Finder::restart()
+{
+	matches.clear();
+	current = 0;
+	searched = 0;
+}
+
+void Finder::update(const Page& page)
+{
+	findInPage(page, needle, ignoreCase, searched, matches);
+	searched = page.size();
+}
+
+size_t Finder::firstFrom(size_t item) const
+{
+	return std::lower_bound(matches.begin(), matches.end(), item, [](const FindMatch& m, size_t item) {
+		return m.item < item;
+	}) - matches.begin();
+}
+
+void Finder::next()
+{
+	if(matches.size())
+		current = (current + 1) % matches.size();
+}
+
+void Finder::previous()
+{
+	if(matches.size())
+		current = (current + matches.size() - 1) % matches.size();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "gopher.h"
+
+// The offset of the first occurrence of needle in data, or size if there
+// is none. With ignoreCase, ASCII letters match either case. In builds
+// with SSE2, blocks of 32 bytes (AVX2) or 16 (SSE2) are tested at once for
+// the needle's first and last bytes, and only the candidates that pass
+// both are compared.
+size_t findBytes(const char* data, size_t size, const char* needle, size_t length, bool ignoreCase);
+
+// A match: the item it is in and where it starts in that item's text.
+struct FindMatch
+{
+	uint32_t item;
+	uint32_t start;
+};
+
+// Appends the matches in the texts of items [from, page.size()) to
+// matches, without overlaps. A page's texts lie in its arena in item
+// order, so the whole range is scanned in one pass and each hit mapped
+// to its item as the scan goes.
+void findInPage(const Page& page, const std::string& needle, bool ignoreCase, size_t from, std::vector<FindMatch>& matches);
+
+// The matches of a find over a page that may still be loading. Moving to
+// the next or previous match is an index step into matches.
+struct Finder
+{
+	std::string needle;
+	bool ignoreCase;
+	std::vector<FindMatch> matches;
+	size_t current;
+	size_t searched;
+
+	Finder() : ignoreCase(true), current(0), searched(0) {}
+
+	void start(const std::string& needle, bool ignoreCase);
+	// forgets the matches, for a new page
+	void restart();
+	// searches the items added since the last update
+	void update(const Page& page);
+	// the first match in or after item, or matches.size()
+	size_t firstFrom(size_t item) const;
+	void next();
+	void previous();
+};
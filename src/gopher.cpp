@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <cstring>
+#include "gopher.h"
+#include "scan.h"
+
+// bytes scanned for delimiters at a time, bounding the offset tables
+const size_t SCAN_WINDOW = 0x10000;
+
+int docType(int code)
+{
+	switch(code)
+	{
+	case 'i':
+		return TYPE_INFO;
+	case '1':
+		return TYPE_DIR;
+	case '0':
+		return TYPE_FILE;
+	case '4':
+	case '5':
+	case '6':
+	case '9':
+		return TYPE_BINARY;
+	case 'g':
+	case 'I':
+		return TYPE_IMAGE;
+	case 's':
+		return TYPE_AUDIO;
+	case '7':
+		return TYPE_SEARCH;
+	default:
+		return TYPE_UNKNOWN;
+	}
+}
+
+std::string Page::url(size_t i) const
+{
+	if(!hasUrl(i))
+		return "";
+	std::string path(bytes, pathStarts[i], pathLengths[i]);
+	if(path[0] != '/')
+		path.insert(0, "/");
+	std::string url = "gopher://" + hostNames[hosts[i]];
+	if(ports[i] != 70)
+		url += ":" + std::to_string(ports[i]);
+	return url + "/" + codes[i] + path;
+}
+
+size_t Page::receive(const char* data, size_t size)
+{
+	size_t offset = bytes.size();
+	bytes.append(data, size);
+	received += size;
+	return offset;
+}
+
+void Page::addLine(uint32_t start, uint32_t length, char code)
+{
+	types.push_back(docType(code));
+	codes.push_back(code);
+	textStarts.push_back(start);
+	textLengths.push_back(length);
+	pathStarts.push_back(0);
+	pathLengths.push_back(0);
+	hosts.push_back(NO_HOST);
+	ports.push_back(0);
+}
+
+void Page::addItem(char code, uint32_t textStart, uint32_t textLength, uint32_t pathStart, uint32_t pathLength, const std::string& host, uint16_t port)
+{
+	auto id = hostIds.find(host);
+	if(id == hostIds.end())
+	{
+		id = hostIds.insert(std::make_pair(host, uint32_t(hostNames.size()))).first;
+		hostNames.push_back(host);
+	}
+	types.push_back(docType(code));
+	codes.push_back(code);
+	textStarts.push_back(textStart);
+	textLengths.push_back(textLength);
+	pathStarts.push_back(pathStart);
+	pathLengths.push_back(pathLength);
+	hosts.push_back(id->second);
+	ports.push_back(port);
+}
+
+void Page::addBlank()
+{
+	addLine(bytes.size(), 0);
+}
+
+// Shows a message on the page. Its text is kept in the arena after the
+// received bytes.
+void Page::addText(const std::string& text)
+{
+	size_t start = bytes.size();
+	bytes += text;
+	while(start < bytes.size())
+	{
+		size_t end = bytes.find('\n', start);
+		if(end == std::string::npos)
+			end = bytes.size();
+		addLine(start, end - start);
+		start = end + 1;
+	}
+}
+
+size_t Page::memory() const
+{
+	size_t hostBytes = 0;
+	for(auto& h : hostNames)
+		hostBytes += 2 * h.capacity();
+	return bytes.capacity() + types.capacity() + codes.capacity()
+		+ (textStarts.capacity() + textLengths.capacity() + pathStarts.capacity() + pathLengths.capacity() + hosts.capacity()) * sizeof(uint32_t)
+		+ ports.capacity() * sizeof(uint16_t) + hostBytes;
+}
+
+void MenuParser::reset()
+{
+	state = CODE;
+	pos = 0;
+	code = 0;
+	field = 0;
+	delimiters.clear();
+	next = 0;
+}
+
+void MenuParser::emit(Page& page)
+{
+	uint32_t& end = ends[field];
+	if(end > starts[field] && page.bytes[end-1] == '\r')
+		--end;
+	if(field == 0 && code == '.' && end == starts[0])
+	{
+		state = DONE;
+		return;
+	}
+
+	int type = docType(code);
+	if(type != TYPE_INFO && field >= 3)
+	{
+		const char* port = page.bytes.data() + starts[3];
+		const char* portEnd = page.bytes.data() + ends[3];
+		while(port < portEnd && isspace(*port))
+			++port;
+		unsigned long number = 0;
+		for(; port < portEnd && isdigit(*port); ++port)
+			number = number * 10 + (*port - '0');
+		if(number == 0 || number > 0xffff)
+			number = 70;
+		host.assign(page.bytes, starts[2], ends[2] - starts[2]);
+		page.addItem(code, starts[0], ends[0] - starts[0], starts[1], ends[1] - starts[1], host, number);
+	}
+	else
+		page.addLine(starts[0], ends[0] - starts[0], code);
+
+	field = 0;
+	state = CODE;
+}
+
+void MenuParser::parse(Page& page)
+{
+	const char* data = page.bytes.data();
+	size_t end = page.bytes.size();
+	while(pos < end && state != DONE)
+	{
+		if(state == CODE)
+		{
+			char c = data[pos++];
+			if(c == '\n')
+				continue;
+			if(c == '\r' && (pos == end || data[pos] == '\n'))
+				continue;
+			code = c;
+			state = FIELD;
+			starts[0] = pos;
+		}
+		else
+		{
+			// the table may still hold delimiters CODE stepped over
+			while(next < delimiters.size() && delimiters[next] < pos)
+				++next;
+			if(next == delimiters.size())
+			{
+				size_t window = std::min(end - pos, SCAN_WINDOW);
+				delimiters.clear();
+				next = 0;
+				scanBytes(data + pos, window, '\t', '\n', pos, delimiters);
+				if(delimiters.empty())
+				{
+					pos += window;
+					continue;
+				}
+			}
+			pos = delimiters[next++];
+			if(state == FIELD)
+				ends[field] = pos;
+			if(data[pos++] == '\n')
+				emit(page);
+			else if(field < 3)
+				starts[++field] = pos;
+			else
+				state = IGNORE;
+		}
+	}
+}
+
+void MenuParser::feed(Page& page, const char* data, size_t size)
+{
+	size_t offset = page.receive(data, size);
+	if(state == CODE)
+		pos = offset;
+	parse(page);
+}
+
+void MenuParser::finish(Page& page)
+{
+	if(state == FIELD || state == IGNORE)
+	{
+		if(state == FIELD)
+			ends[field] = pos;
+		emit(page);
+	}
+	state = DONE;
+}
+
+void TextParser::emit(Page& page, size_t end)
+{
+	if(end > lineStart && page.bytes[end-1] == '\r')
+		--end;
+	page.addLine(lineStart, end - lineStart);
+}
+
+void TextParser::parse(Page& page)
+{
+	const char* data = page.bytes.data();
+	size_t end = page.bytes.size();
+	while(pos < end)
+	{
+		auto nl = static_cast<const char*>(memchr(data + pos, '\n', end - pos));
+		if(!nl)
+		{
+			pos = end;
+			break;
+		}
+		pos = nl - data;
+		emit(page, pos);
+		lineStart = ++pos;
+	}
+}
+
+void TextParser::feed(Page& page, const char* data, size_t size)
+{
+	size_t offset = page.receive(data, size);
+	if(pos == lineStart)
+		pos = lineStart = offset;
+	parse(page);
+}
+
+void TextParser::finish(Page& page)
+{
+	if(pos > lineStart)
+		emit(page, pos);
+	lineStart = pos;
+}
+
+// Reduces equivalent spellings of a url to one form: the scheme is added,
+// the host is lowercased, the default port is dropped and an empty
+// selector becomes the root menu.
+std::string normalizeUrl(const std::string& url)
+{
+	std::string addr = url;
+	if(addr.compare(0, 9, "gopher://") == 0)
+		addr.erase(0, 9);
+	size_t sl = addr.find('/');
+	std::string host = addr.substr(0, sl);
+	std::string rest = sl == std::string::npos ? "" : addr.substr(sl);
+	for(auto& c : host)
+		c = tolower(c);
+	if(host.size() > 3 && host.compare(host.size()-3, 3, ":70") == 0)
+		host.erase(host.size()-3);
+	if(rest == "" || rest == "/" || rest == "/1/")
+		rest = "/1";
+	return "gopher://" + host + rest;
+}
+
+int urlType(const std::string& url)
+{
+	std::string addr = url;
+	if(addr.compare(0, 9, "gopher://") == 0)
+		addr.erase(0, 9);
+	size_t sl = addr.find('/');
+	if(sl == std::string::npos || sl+1 == addr.size())
+		return TYPE_DIR;
+	return docType(addr[sl+1]);
+}
+
+void parseList(const char* data, size_t size, Page& page)
+{
+	MenuParser parser;
+	parser.feed(page, data, size);
+	parser.finish(page);
+}
+
+void parseText(const char* data, size_t size, Page& page)
+{
+	TextParser parser;
+	parser.feed(page, data, size);
+	parser.finish(page);
+}
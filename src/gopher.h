@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum NodeType
+{
+	TYPE_DIR,
+	TYPE_INFO,
+	TYPE_FILE,
+	TYPE_BINARY,
+	TYPE_IMAGE,
+	TYPE_AUDIO,
+	TYPE_SEARCH,
+	TYPE_UNKNOWN,
+	TYPE_MAX,
+};
+
+int docType(int code);
+
+const uint32_t NO_HOST = 0xffffffff;
+
+// A parsed page. The page's bytes live in a single arena and each item is
+// a set of offset/length records into it, stored one array per field.
+// Urls are only built when asked for.
+struct Page
+{
+	std::string bytes;
+	size_t received = 0;
+
+	std::vector<uint8_t> types;
+	std::vector<char> codes;
+	std::vector<uint32_t> textStarts;
+	std::vector<uint32_t> textLengths;
+	std::vector<uint32_t> pathStarts;
+	std::vector<uint32_t> pathLengths;
+	std::vector<uint32_t> hosts;
+	std::vector<uint16_t> ports;
+
+	std::vector<std::string> hostNames;
+	std::unordered_map<std::string, uint32_t> hostIds;
+
+	size_t size() const { return types.size(); }
+	const char* text(size_t i) const { return bytes.data() + textStarts[i]; }
+	size_t textLength(size_t i) const { return textLengths[i]; }
+	bool hasUrl(size_t i) const { return hosts[i] != NO_HOST; }
+	std::string url(size_t i) const;
+
+	size_t receive(const char* data, size_t size);
+	void addLine(uint32_t start, uint32_t length, char code = 'i');
+	void addItem(char code, uint32_t textStart, uint32_t textLength, uint32_t pathStart, uint32_t pathLength, const std::string& host, uint16_t port);
+	void addBlank();
+	void addText(const std::string& text);
+	size_t memory() const;
+};
+
+// Resumable gopher menu parser. Data can arrive in chunks split at any
+// byte; each item is added to the page as soon as its line is complete.
+// Handles CRLF and LF line endings and stops at the "." terminator. Tabs
+// and newlines are found a window at a time with scanBytes, into
+// delimiters; it and host are reused, so parsing doesn't allocate per line.
+struct MenuParser
+{
+	enum State { CODE, FIELD, IGNORE, DONE } state;
+	size_t pos;
+	char code;
+	int field;
+	uint32_t starts[4];
+	uint32_t ends[4];
+	std::vector<uint32_t> delimiters;
+	size_t next;
+	// the current item's host, reusing its capacity from item to item
+	std::string host;
+
+	MenuParser() { reset(); }
+
+	void reset();
+	void feed(Page& page, const char* data, size_t size);
+	void finish(Page& page);
+
+private:
+	void parse(Page& page);
+	void emit(Page& page);
+};
+
+// Splits a text document into one info item per line.
+struct TextParser
+{
+	size_t pos;
+	size_t lineStart;
+
+	TextParser() { reset(); }
+
+	void reset() { pos = lineStart = 0; }
+	void feed(Page& page, const char* data, size_t size);
+	void finish(Page& page);
+
+private:
+	void parse(Page& page);
+	void emit(Page& page, size_t end);
+};
+
+std::string normalizeUrl(const std::string& url);
+// The document type named by a url's item code, a menu if it has none.
+int urlType(const std::string& url);
+
+void parseList(const char* data, size_t size, Page& page);
+void parseText(const char* data, size_t size, Page& page);
@@ -0,0 +1,239 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include "gopher.h"
+#include "headless.h"
+#include "mirror.h"
+#include "queue.h"
+#include "str.h"
+#include "timing.h"
+#include "worker.h"
+
+const int DEFAULT_JOBS = 4;
+
+namespace
+{
+	struct Job
+	{
+		std::string url;
+		std::string path;
+		int reqid = 0;
+		bool done = false;
+		// output that arrived while an earlier job was still writing
+		std::string held;
+	};
+
+	void usage()
+	{
+		std::cerr << "usage: ferret --fetch <url> [-o file]\n"
+			<< "       ferret --fetch-many <urls.txt> [-j N] [-o directory]\n";
+	}
+
+	std::string selector(const std::string& url)
+	{
+		std::string s = url;
+		if(s.find("gopher://") == 0)
+			s.erase(0, 9);
+		auto slash = s.find('/');
+		return slash == std::string::npos ? "" : s.substr(slash+1);
+	}
+
+	// e.g. "3-about.txt" for the third url, gopher://host/0/docs/about.txt
+	std::string fileName(const std::string& url, size_t index)
+	{
+		std::string s = selector(url);
+		s.erase(0, std::min(s.size(), size_t(2)));
+		s.erase(0, s.rfind('/')+1);
+		s = s.substr(0, s.find('\t'));
+		return std::to_string(index+1) + "-" + (s.size() ? s : "index");
+	}
+
+	bool readList(const char* path, std::vector<std::string>& urls)
+	{
+		std::ifstream in(path);
+		if(!in)
+			return false;
+		std::string line;
+		while(std::getline(in, line))
+		{
+			strip(line);
+			if(line.size() && line[0] != '#')
+				urls.push_back(line);
+		}
+		return true;
+	}
+
+	void writeOut(const char* data, size_t size)
+	{
+		while(size)
+		{
+			ssize_t w = write(STDOUT_FILENO, data, size);
+			if(w == -1 && errno == EINTR)
+				continue;
+			if(w <= 0)
+			{
+				std::cerr << "Failed to write output: " << strerror(errno) << "\n";
+				exit(1);
+			}
+			data += w;
+			size -= w;
+		}
+	}
+
+	void report(const Job& job, const Message& m)
+	{
+		std::cerr << job.url << ": ";
+		if(m.type == Message::ERROR)
+			std::cerr << "failed: " << m.data << ", ";
+		std::cerr << describe(m.timing) << "\n";
+	}
+}
+
+bool headlessRequested(int argc, char** argv)
+{
+	for(int i = 1; i < argc; ++i)
+	{
+		if(!strcmp(argv[i], "--fetch") || !strcmp(argv[i], "--fetch-many") || !strcmp(argv[i], "--mirror"))
+			return true;
+	}
+	return false;
+}
+
+void waitForMessages(int timeout)
+{
+	pollfd p = { queueEvent, POLLIN, 0 };
+	if(!dataQueue.size())
+		poll(&p, 1, timeout);
+	uint64_t count;
+	while(read(queueEvent, &count, sizeof(count)) > 0);
+	queueSignalled = false;
+}
+
+// Keeps up to -j requests in flight on the worker. Responses to stdout
+// are written in list order: the earliest unfinished job streams and
+// later ones are held until it is done.
+int runHeadless(int argc, char** argv)
+{
+	for(int i = 1; i < argc; ++i)
+	{
+		if(!strcmp(argv[i], "--mirror"))
+			return runMirror(argc, argv);
+	}
+	std::vector<std::string> urls;
+	std::string output;
+	const char* list = 0;
+	int limit = DEFAULT_JOBS;
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if(i+1 == argc)
+		{
+			usage();
+			return 2;
+		}
+		if(arg == "--fetch")
+			urls.push_back(argv[++i]);
+		else if(arg == "--fetch-many")
+			list = argv[++i];
+		else if(arg == "-o")
+			output = argv[++i];
+		else if(arg == "-j")
+			limit = atoi(argv[++i]);
+		else
+		{
+			usage();
+			return 2;
+		}
+	}
+	if(list && !readList(list, urls))
+	{
+		std::cerr << "Could not read " << list << "\n";
+		return 2;
+	}
+	if(urls.empty() || limit < 1 || (!list && urls.size() > 1))
+	{
+		usage();
+		return 2;
+	}
+
+	std::vector<Job> jobs(urls.size());
+	for(size_t i = 0; i < jobs.size(); ++i)
+	{
+		jobs[i].url = urls[i];
+		if(output.size())
+			jobs[i].path = list ? output + "/" + fileName(urls[i], i) : output;
+	}
+
+	std::thread worker = startWorker();
+	std::unordered_map<int, size_t> active;
+	std::vector<Message> messages;
+	size_t started = 0, finished = 0, flushed = 0, failed = 0, bytes = 0;
+	int64_t start = steadyMicroseconds();
+	while(finished < jobs.size())
+	{
+		while(started < jobs.size() && active.size() < size_t(limit))
+		{
+			Job& j = jobs[started];
+			if(j.path.size())
+				j.reqid = download(j.url, j.path, 0, FOREGROUND);
+			else
+			{
+				j.reqid = newRequest();
+				fetch(j.reqid, j.url, urlType(j.url));
+			}
+			active[j.reqid] = started++;
+		}
+
+		waitForMessages(-1);
+		dataQueue.popAll(messages);
+		for(auto& m : messages)
+		{
+			auto a = active.find(m.reqid);
+			if(a == active.end())
+				continue;
+			Job& j = jobs[a->second];
+			if(m.type == Message::DATA)
+			{
+				if(a->second == flushed)
+					writeOut(m.slice.data(), m.slice.size);
+				else
+					j.held.append(m.slice.data(), m.slice.size);
+				continue;
+			}
+			report(j, m);
+			j.done = true;
+			bytes += m.timing.bytes;
+			failed += m.type == Message::ERROR;
+			++finished;
+			active.erase(a);
+		}
+		messages.clear();
+
+		for(; flushed < started; ++flushed)
+		{
+			Job& j = jobs[flushed];
+			writeOut(j.held.data(), j.held.size());
+			std::string().swap(j.held);
+			if(!j.done)
+				break;
+		}
+	}
+	endWorker();
+	worker.join();
+
+	double ms = (steadyMicroseconds() - start) / 1000.0;
+	char buf[128];
+	snprintf(buf, sizeof(buf), "%zu urls, %zu failed, %.1f KiB in %.1f ms, %.0f KiB/s\n",
+		jobs.size(), failed, bytes / 1024.0, ms, ms > 0 ? bytes / 1.024 / ms : 0);
+	std::cerr << buf;
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Command line retrieval without the GUI:
+//   ferret --fetch <url> [-o file]
+//   ferret --fetch-many <urls.txt> [-j N] [-o directory]
+// Responses go to stdout, in the order given, or to files with -o. Timing
+// for each url, and a total, are printed to stderr. --mirror is described
+// in mirror.h.
+bool headlessRequested(int argc, char** argv);
+int runHeadless(int argc, char** argv);
+
+// Waits up to timeout milliseconds, or for ever if -1, for the worker to
+// queue messages.
+void waitForMessages(int timeout);
@@ -0,0 +1,772 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fd.h"
+#include "index.h"
+#include "str.h"
+
+const char INDEX_MAGIC[8] = { 'F', 'R', 'I', 'X', '1', 0, 0, 0 };
+const size_t MIN_TOKEN = 2;
+const size_t MAX_TOKEN = 40;
+const size_t MAX_TITLE = 80;
+const size_t FLUSH_DOCUMENTS = 1000;
+const int IDLE_FLUSH_SECONDS = 30;
+const size_t MAX_SEGMENTS = 8;
+const size_t MERGE_WIDTH = 4;
+const double BM25_K1 = 1.2;
+const double BM25_B = 0.75;
+
+struct SegmentHeader
+{
+	char magic[8];
+	uint32_t docs;
+	uint32_t terms;
+	uint64_t docsOffset;
+	uint64_t termsOffset;
+	uint64_t stringsOffset;
+	uint64_t postingsOffset;
+	uint64_t size;
+};
+
+struct DocRecord
+{
+	uint32_t id;
+	uint32_t length;
+	uint32_t url;
+	uint32_t urlLength;
+	uint32_t title;
+	uint32_t titleLength;
+};
+
+struct TermRecord
+{
+	uint32_t term;
+	uint32_t termLength;
+	uint32_t df;
+	uint32_t postingsLength;
+	uint64_t postings;
+};
+
+namespace
+{
+	// Lowercased runs of ASCII letters and digits. Bytes above 0x7f are
+	// kept as they are, so UTF-8 words hold together.
+	template<class F> void tokenize(const char* s, size_t n, F f)
+	{
+		std::string token;
+		for(size_t i = 0; i <= n; ++i)
+		{
+			unsigned char c = i < n ? s[i] : ' ';
+			if((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80)
+				token += c;
+			else if(c >= 'A' && c <= 'Z')
+				token += c + ('a' - 'A');
+			else if(token.size())
+			{
+				if(token.size() >= MIN_TOKEN && token.size() <= MAX_TOKEN)
+					f(token);
+				token.clear();
+			}
+		}
+	}
+
+	void putVarint(std::string& out, uint32_t v)
+	{
+		while(v >= 0x80)
+		{
+			out += char(v | 0x80);
+			v >>= 7;
+		}
+		out += char(v);
+	}
+
+	uint32_t getVarint(const uint8_t*& p, const uint8_t* end)
+	{
+		uint32_t v = 0;
+		for(int shift = 0; p < end && shift < 35; shift += 7)
+		{
+			uint8_t b = *p++;
+			v |= uint32_t(b & 0x7f) << shift;
+			if(!(b & 0x80))
+				break;
+		}
+		return v;
+	}
+
+	int compareTerm(const char* a, size_t al, const std::string& b)
+	{
+		int c = memcmp(a, b.data(), std::min(al, b.size()));
+		return c ? c : (al < b.size() ? -1 : al > b.size());
+	}
+
+	bool writeAll(int fd, const void* data, size_t size)
+	{
+		auto p = static_cast<const char*>(data);
+		while(size)
+		{
+			ssize_t w = write(fd, p, size);
+			if(w == -1 && errno == EINTR)
+				continue;
+			if(w <= 0)
+				return false;
+			p += w;
+			size -= w;
+		}
+		return true;
+	}
+
+	// Collects a segment in memory and writes it out in one go. Terms must
+	// be added in order.
+	struct SegmentWriter
+	{
+		std::vector<DocRecord> docs;
+		std::vector<TermRecord> terms;
+		std::string strings;
+		std::string postings;
+
+		uint32_t addString(const std::string& s)
+		{
+			uint32_t offset = strings.size();
+			strings += s;
+			return offset;
+		}
+
+		void addDoc(uint32_t id, uint32_t length, const std::string& url, const std::string& title)
+		{
+			DocRecord d;
+			d.id = id;
+			d.length = length;
+			d.url = addString(url);
+			d.urlLength = url.size();
+			d.title = addString(title);
+			d.titleLength = title.size();
+			docs.push_back(d);
+		}
+
+		void addTerm(const std::string& term, const PostingList& list)
+		{
+			TermRecord t;
+			t.term = addString(term);
+			t.termLength = term.size();
+			t.df = list.size();
+			t.postings = postings.size();
+			uint32_t last = 0;
+			for(auto& p : list)
+			{
+				putVarint(postings, p.first - last);
+				putVarint(postings, p.second);
+				last = p.first;
+			}
+			t.postingsLength = postings.size() - t.postings;
+			terms.push_back(t);
+		}
+
+		// written beside path and renamed over it, so a segment is whole or absent
+		bool write(const std::string& path)
+		{
+			SegmentHeader h;
+			memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+			h.docs = docs.size();
+			h.terms = terms.size();
+			h.docsOffset = sizeof(h);
+			h.termsOffset = h.docsOffset + docs.size() * sizeof(DocRecord);
+			h.stringsOffset = h.termsOffset + terms.size() * sizeof(TermRecord);
+			h.postingsOffset = h.stringsOffset + strings.size();
+			h.size = h.postingsOffset + postings.size();
+			std::string tmp = path + ".tmp";
+			UniqueFd fd(::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+			bool ok = fd.valid() && writeAll(fd.get(), &h, sizeof(h))
+				&& writeAll(fd.get(), docs.data(), docs.size() * sizeof(DocRecord))
+				&& writeAll(fd.get(), terms.data(), terms.size() * sizeof(TermRecord))
+				&& writeAll(fd.get(), strings.data(), strings.size())
+				&& writeAll(fd.get(), postings.data(), postings.size());
+			ok = fd.close() == 0 && ok;
+			if(!ok || rename(tmp.c_str(), path.c_str()) == -1)
+			{
+				unlink(tmp.c_str());
+				return false;
+			}
+			return true;
+		}
+	};
+
+	double bm25(double idf, uint32_t tf, uint32_t length, double averageLength)
+	{
+		return idf * tf * (BM25_K1 + 1) / (tf + BM25_K1 * (1 - BM25_B + BM25_B * length / averageLength));
+	}
+}
+
+Segment::~Segment()
+{
+	if(map)
+		munmap(map, mapSize);
+}
+
+bool Segment::load(const std::string& p)
+{
+	path = p;
+	UniqueFd fd(::open(p.c_str(), O_RDONLY | O_CLOEXEC));
+	struct stat st;
+	if(!fd.valid() || fstat(fd.get(), &st) == -1 || size_t(st.st_size) < sizeof(SegmentHeader))
+		return false;
+	void* m = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd.get(), 0);
+	if(m == MAP_FAILED)
+		return false;
+	map = m;
+	mapSize = st.st_size;
+	auto base = static_cast<const char*>(m);
+	header = reinterpret_cast<const SegmentHeader*>(base);
+	if(memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) || header->size != mapSize
+		|| header->docsOffset + uint64_t(header->docs) * sizeof(DocRecord) > header->termsOffset
+		|| header->termsOffset + uint64_t(header->terms) * sizeof(TermRecord) > header->stringsOffset
+		|| header->stringsOffset > header->postingsOffset || header->postingsOffset > mapSize)
+		return false;
+	docs = reinterpret_cast<const DocRecord*>(base + header->docsOffset);
+	terms = reinterpret_cast<const TermRecord*>(base + header->termsOffset);
+	strings = base + header->stringsOffset;
+	postings = reinterpret_cast<const uint8_t*>(base + header->postingsOffset);
+	return true;
+}
+
+size_t Segment::size() const
+{
+	return header->docs;
+}
+
+size_t Segment::termCount() const
+{
+	return header->terms;
+}
+
+uint32_t Segment::id(size_t doc) const
+{
+	return docs[doc].id;
+}
+
+uint32_t Segment::length(size_t doc) const
+{
+	return docs[doc].length;
+}
+
+std::string Segment::url(size_t doc) const
+{
+	return std::string(strings + docs[doc].url, docs[doc].urlLength);
+}
+
+std::string Segment::title(size_t doc) const
+{
+	return std::string(strings + docs[doc].title, docs[doc].titleLength);
+}
+
+std::string Segment::term(size_t t) const
+{
+	return std::string(strings + terms[t].term, terms[t].termLength);
+}
+
+const TermRecord* Segment::find(const std::string& term) const
+{
+	size_t lo = 0, hi = termCount();
+	while(lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		if(compareTerm(strings + terms[mid].term, terms[mid].termLength, term) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if(lo < termCount() && compareTerm(strings + terms[lo].term, terms[lo].termLength, term) == 0)
+		return &terms[lo];
+	return 0;
+}
+
+void Segment::decode(const TermRecord* t, PostingList& out) const
+{
+	out.clear();
+	const uint8_t* p = postings + t->postings;
+	const uint8_t* end = p + t->postingsLength;
+	uint32_t doc = 0;
+	while(p < end)
+	{
+		doc += getVarint(p, end);
+		uint32_t tf = getVarint(p, end);
+		if(doc < size())
+			out.push_back({doc, tf});
+	}
+}
+
+SearchIndex::~SearchIndex()
+{
+	close();
+}
+
+// Loads the segments under dir and starts the indexing thread. A segment
+// whose documents also appear in a newer one is the leftover input of an
+// interrupted merge, and is deleted.
+bool SearchIndex::open(const std::string& d)
+{
+	dir = d;
+	if(mkdir(dir.c_str(), 0700) == -1 && errno != EEXIST)
+	{
+		std::cerr << "Could not create index directory " << dir << ": " << strerror(errno) << "\n";
+		return false;
+	}
+	DIR* listing = opendir(dir.c_str());
+	if(!listing)
+		return false;
+	std::vector<uint32_t> numbers;
+	while(dirent* e = readdir(listing))
+	{
+		std::string name = e->d_name;
+		if(name.size() > 4 && name.compare(name.size()-4, 4, ".tmp") == 0)
+			unlink((dir + "/" + name).c_str());
+		else if(name.size() > 4 && name.compare(name.size()-4, 4, ".seg") == 0)
+			numbers.push_back(strtoul(name.c_str(), 0, 10));
+	}
+	closedir(listing);
+	std::sort(numbers.begin(), numbers.end());
+
+	std::unordered_map<uint32_t, size_t> owner;
+	std::vector<bool> leftover;
+	for(uint32_t n : numbers)
+	{
+		std::string path = dir + "/" + std::to_string(n) + ".seg";
+		std::shared_ptr<Segment> s(new Segment);
+		nextSegment = std::max(nextSegment, n + 1);
+		if(!s->load(path))
+		{
+			std::cerr << "Ignoring damaged index segment " << path << "\n";
+			continue;
+		}
+		leftover.push_back(false);
+		for(size_t i = 0; i < s->size(); ++i)
+		{
+			auto o = owner.insert(std::make_pair(s->id(i), segments.size()));
+			if(!o.second)
+				leftover[o.first->second] = true;
+		}
+		segments.push_back(s);
+	}
+	for(size_t i = segments.size(); i-- > 0;)
+	{
+		if(leftover[i])
+		{
+			unlink(segments[i]->path.c_str());
+			segments.erase(segments.begin() + i);
+		}
+	}
+	for(auto& s : segments)
+	{
+		for(size_t i = 0; i < s->size(); ++i)
+		{
+			remember(s->url(i), s->id(i), s->length(i));
+			nextId = std::max(nextId, s->id(i) + 1);
+		}
+	}
+	thread = std::thread(&SearchIndex::run, this);
+	return true;
+}
+
+// Writes out what is left and stops the indexing thread.
+void SearchIndex::close()
+{
+	if(!thread.joinable())
+		return;
+	{
+		std::unique_lock<std::mutex> lock(queueMtx);
+		stopping = true;
+	}
+	queueCondition.notify_one();
+	thread.join();
+}
+
+void SearchIndex::add(const std::string& url, const std::shared_ptr<const Page>& page)
+{
+	if(!thread.joinable())
+		return;
+	{
+		std::unique_lock<std::mutex> lock(queueMtx);
+		queue.push_back(std::make_pair(url, page));
+	}
+	queueCondition.notify_one();
+}
+
+void SearchIndex::flush()
+{
+	std::unique_lock<std::mutex> lock(queueMtx);
+	if(!thread.joinable())
+		return;
+	size_t target = ++flushRequests;
+	queueCondition.notify_one();
+	flushCondition.wait(lock, [&](){ return flushes >= target; });
+}
+
+size_t SearchIndex::size()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	return latest.size();
+}
+
+void SearchIndex::run()
+{
+	std::unique_lock<std::mutex> lock(queueMtx);
+	while(true)
+	{
+		bool woken = queueCondition.wait_for(lock, std::chrono::seconds(IDLE_FLUSH_SECONDS), [&](){
+			return stopping || queue.size() || flushRequests > flushes;
+		});
+		if(queue.size())
+		{
+			auto item = std::move(queue.front());
+			queue.pop_front();
+			lock.unlock();
+			index(item.first, *item.second);
+			lock.lock();
+			continue;
+		}
+		size_t target = flushRequests;
+		lock.unlock();
+		writeMemory();
+		lock.lock();
+		if(woken)
+		{
+			flushes = target;
+			flushCondition.notify_all();
+		}
+		if(stopping)
+			break;
+	}
+}
+
+void SearchIndex::index(const std::string& url, const Page& page)
+{
+	std::unordered_map<std::string, uint32_t> counts;
+	uint32_t length = 0;
+	auto count = [&](const std::string& token) {
+		++counts[token];
+		++length;
+	};
+	std::string title;
+	tokenize(url.data(), url.size(), count);
+	for(size_t i = 0; i < page.size(); ++i)
+	{
+		tokenize(page.text(i), page.textLength(i), count);
+		if(title.empty())
+		{
+			std::string text(page.text(i), page.textLength(i));
+			title = strip(text).substr(0, MAX_TITLE);
+		}
+	}
+	if(title.empty())
+		title = url;
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		uint32_t id = nextId++;
+		uint32_t local = memory.docs.size();
+		memory.docs.push_back({id, length, url, title});
+		for(auto& c : counts)
+			memory.postings[c.first].push_back({local, c.second});
+		remember(url, id, length);
+	}
+	if(memory.docs.size() >= FLUSH_DOCUMENTS)
+		writeMemory();
+}
+
+void SearchIndex::remember(const std::string& url, uint32_t id, uint32_t length)
+{
+	auto i = latest.find(url);
+	if(i == latest.end())
+	{
+		latest[url] = {id, length};
+		totalLength += length;
+	}
+	else if(id > i->second.id)
+	{
+		dead.insert(i->second.id);
+		totalLength += length - i->second.length;
+		i->second = {id, length};
+	}
+	else
+		dead.insert(id);
+}
+
+// Only the indexing thread changes memory, so it can read it unlocked.
+void SearchIndex::writeMemory()
+{
+	if(memory.docs.empty())
+		return;
+	SegmentWriter w;
+	for(auto& d : memory.docs)
+		w.addDoc(d.id, d.length, d.url, d.title);
+	std::vector<const std::pair<const std::string, PostingList>*> terms;
+	for(auto& p : memory.postings)
+		terms.push_back(&p);
+	std::sort(terms.begin(), terms.end(), [](const std::pair<const std::string, PostingList>* a, const std::pair<const std::string, PostingList>* b) {
+		return a->first < b->first;
+	});
+	for(auto t : terms)
+		w.addTerm(t->first, t->second);
+
+	std::string path = dir + "/" + std::to_string(nextSegment) + ".seg";
+	std::shared_ptr<Segment> s(new Segment);
+	if(!w.write(path) || !s->load(path))
+	{
+		std::cerr << "Could not write index segment " << path << "\n";
+		return;
+	}
+	++nextSegment;
+	size_t count;
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		segments.push_back(s);
+		memory = MemorySegment();
+		count = segments.size();
+	}
+	if(count > MAX_SEGMENTS)
+		merge();
+}
+
+// Merges the MERGE_WIDTH smallest segments into one, dropping dead
+// documents. Searches carry on against the old segments until the new
+// one is in place.
+void SearchIndex::merge()
+{
+	std::vector<std::shared_ptr<Segment>> inputs;
+	std::unordered_set<uint32_t> gone;
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		inputs = segments;
+		std::sort(inputs.begin(), inputs.end(), [](const std::shared_ptr<Segment>& a, const std::shared_ptr<Segment>& b) {
+			return a->mapSize < b->mapSize;
+		});
+		inputs.resize(std::min(inputs.size(), MERGE_WIDTH));
+		for(auto& s : inputs)
+		{
+			for(size_t i = 0; i < s->size(); ++i)
+			{
+				if(dead.count(s->id(i)))
+					gone.insert(s->id(i));
+			}
+		}
+	}
+
+	// live documents in id order, numbered afresh
+	std::vector<std::pair<uint32_t, std::pair<size_t, size_t>>> live;
+	std::vector<std::vector<int64_t>> renumber(inputs.size());
+	for(size_t i = 0; i < inputs.size(); ++i)
+	{
+		renumber[i].assign(inputs[i]->size(), -1);
+		for(size_t d = 0; d < inputs[i]->size(); ++d)
+		{
+			if(!gone.count(inputs[i]->id(d)))
+				live.push_back({inputs[i]->id(d), {i, d}});
+		}
+	}
+	std::sort(live.begin(), live.end());
+	SegmentWriter w;
+	for(size_t n = 0; n < live.size(); ++n)
+	{
+		auto& s = inputs[live[n].second.first];
+		size_t d = live[n].second.second;
+		renumber[live[n].second.first][d] = n;
+		w.addDoc(s->id(d), s->length(d), s->url(d), s->title(d));
+	}
+
+	// walk the sorted term tables side by side
+	std::vector<size_t> next(inputs.size(), 0);
+	PostingList list, merged;
+	while(true)
+	{
+		std::string term;
+		bool any = false;
+		for(size_t i = 0; i < inputs.size(); ++i)
+		{
+			if(next[i] == inputs[i]->termCount())
+				continue;
+			std::string t = inputs[i]->term(next[i]);
+			if(!any || t < term)
+				term = t;
+			any = true;
+		}
+		if(!any)
+			break;
+		merged.clear();
+		for(size_t i = 0; i < inputs.size(); ++i)
+		{
+			if(next[i] == inputs[i]->termCount() || inputs[i]->term(next[i]) != term)
+				continue;
+			inputs[i]->decode(&inputs[i]->terms[next[i]], list);
+			for(auto& p : list)
+			{
+				int64_t n = renumber[i][p.first];
+				if(n >= 0)
+					merged.push_back({uint32_t(n), p.second});
+			}
+			++next[i];
+		}
+		if(merged.size())
+		{
+			std::sort(merged.begin(), merged.end());
+			w.addTerm(term, merged);
+		}
+	}
+
+	std::string path = dir + "/" + std::to_string(nextSegment) + ".seg";
+	std::shared_ptr<Segment> s(new Segment);
+	if(!w.write(path) || !s->load(path))
+	{
+		std::cerr << "Could not merge index segments into " << path << "\n";
+		return;
+	}
+	++nextSegment;
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		for(auto& in : inputs)
+			segments.erase(std::find(segments.begin(), segments.end(), in));
+		segments.push_back(s);
+		for(uint32_t id : gone)
+			dead.erase(id);
+	}
+	for(auto& in : inputs)
+		unlink(in->path.c_str());
+}
+
+std::vector<SearchResult> SearchIndex::search(const std::string& query, size_t limit)
+{
+	std::vector<std::string> words;
+	tokenize(query.data(), query.size(), [&](const std::string& t) {
+		if(std::find(words.begin(), words.end(), t) == words.end())
+			words.push_back(t);
+	});
+	std::vector<SearchResult> results;
+	std::unique_lock<std::mutex> lock(mtx);
+	if(words.empty() || latest.empty() || !limit)
+		return results;
+	double n = latest.size();
+	double averageLength = std::max(1.0, totalLength / n);
+
+	std::vector<double> idf;
+	for(auto& word : words)
+	{
+		size_t df = 0;
+		for(auto& s : segments)
+		{
+			if(auto t = s->find(word))
+				df += t->df;
+		}
+		auto m = memory.postings.find(word);
+		if(m != memory.postings.end())
+			df += m->second.size();
+		// dead documents still count until merged away
+		df = std::min(df, size_t(n));
+		idf.push_back(std::log(1 + (n - df + 0.5) / (df + 0.5)));
+	}
+
+	// the best limit hits so far, lowest first; segment -1 is memory
+	struct Hit
+	{
+		double score;
+		int segment;
+		uint32_t doc;
+		bool operator<(const Hit& o) const { return score > o.score; }
+	};
+	std::vector<Hit> best;
+	auto consider = [&](double score, int segment, uint32_t doc) {
+		if(best.size() == limit && score <= best.front().score)
+			return;
+		if(best.size() == limit)
+		{
+			std::pop_heap(best.begin(), best.end());
+			best.pop_back();
+		}
+		best.push_back({score, segment, doc});
+		std::push_heap(best.begin(), best.end());
+	};
+
+	PostingList list;
+	std::vector<double> scores;
+	for(size_t si = 0; si < segments.size(); ++si)
+	{
+		auto& s = *segments[si];
+		scores.assign(s.size(), 0);
+		for(size_t w = 0; w < words.size(); ++w)
+		{
+			auto t = s.find(words[w]);
+			if(!t)
+				continue;
+			s.decode(t, list);
+			for(auto& p : list)
+				scores[p.first] += bm25(idf[w], p.second, s.length(p.first), averageLength);
+		}
+		for(size_t d = 0; d < scores.size(); ++d)
+		{
+			if(scores[d] > 0 && !dead.count(s.id(d)))
+				consider(scores[d], si, d);
+		}
+	}
+	scores.assign(memory.docs.size(), 0);
+	for(size_t w = 0; w < words.size(); ++w)
+	{
+		auto m = memory.postings.find(words[w]);
+		if(m == memory.postings.end())
+			continue;
+		for(auto& p : m->second)
+			scores[p.first] += bm25(idf[w], p.second, memory.docs[p.first].length, averageLength);
+	}
+	for(size_t d = 0; d < scores.size(); ++d)
+	{
+		if(scores[d] > 0 && !dead.count(memory.docs[d].id))
+			consider(scores[d], -1, d);
+	}
+
+	std::sort_heap(best.begin(), best.end());
+	for(auto& h : best)
+	{
+		if(h.segment == -1)
+			results.push_back({memory.docs[h.doc].url, memory.docs[h.doc].title, h.score});
+		else
+			results.push_back({segments[h.segment]->url(h.doc), segments[h.segment]->title(h.doc), h.score});
+	}
+	return results;
+}
+
+void addResults(Page& page, const std::string& query, const std::vector<SearchResult>& results, double milliseconds)
+{
+	char heading[128];
+	snprintf(heading, sizeof(heading), "%zu results in %.1f ms for: ", results.size(), milliseconds);
+	page.addBlank();
+	page.addText(heading + query);
+	page.addBlank();
+	for(auto& r : results)
+	{
+		std::string addr = r.url;
+		if(addr.compare(0, 9, "gopher://") == 0)
+			addr.erase(0, 9);
+		size_t sl = addr.find('/');
+		std::string host = addr.substr(0, sl);
+		std::string rest = sl == std::string::npos ? "" : addr.substr(sl+1);
+		uint16_t port = 70;
+		size_t colon = host.rfind(':');
+		if(colon != std::string::npos)
+		{
+			port = atoi(host.c_str() + colon + 1);
+			host.erase(colon);
+		}
+		char code = rest.size() ? rest[0] : '1';
+		std::string path = rest.size() ? rest.substr(1) : "";
+		uint32_t textStart = page.bytes.size();
+		page.bytes += r.title;
+		uint32_t pathStart = page.bytes.size();
+		page.bytes += path;
+		page.addItem(code, textStart, r.title.size(), pathStart, path.size(), host, port);
+		page.addText("    " + r.url);
+	}
+}
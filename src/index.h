@@ -0,0 +1,129 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "gopher.h"
+
+struct SearchResult
+{
+	std::string url;
+	std::string title;
+	double score;
+};
+
+struct SegmentHeader;
+struct DocRecord;
+struct TermRecord;
+
+typedef std::vector<std::pair<uint32_t, uint32_t>> PostingList;
+
+// An immutable index file, mapped into memory. It holds a header, a
+// record per document, a record per term sorted by term, the strings
+// both point into and, last, the posting lists: for each term, the
+// documents containing it in order, as varint gaps, each followed by a
+// varint count.
+struct Segment
+{
+	std::string path;
+	void* map;
+	size_t mapSize;
+	const SegmentHeader* header;
+	const DocRecord* docs;
+	const TermRecord* terms;
+	const char* strings;
+	const uint8_t* postings;
+
+	Segment() : map(0), mapSize(0), header(0), docs(0), terms(0), strings(0), postings(0) {}
+	~Segment();
+
+	bool load(const std::string& path);
+	size_t size() const;
+	size_t termCount() const;
+	uint32_t id(size_t doc) const;
+	uint32_t length(size_t doc) const;
+	std::string url(size_t doc) const;
+	std::string title(size_t doc) const;
+	std::string term(size_t t) const;
+	const TermRecord* find(const std::string& term) const;
+	void decode(const TermRecord* t, PostingList& out) const;
+};
+
+// Documents added since the last segment was written.
+struct MemorySegment
+{
+	struct Doc
+	{
+		uint32_t id;
+		uint32_t length;
+		std::string url;
+		std::string title;
+	};
+
+	std::vector<Doc> docs;
+	std::unordered_map<std::string, PostingList> postings;
+};
+
+// Incremental full-text index of pages, under dir. add() hands a finished
+// page to a background thread, which tokenizes it into a MemorySegment;
+// every FLUSH_DOCUMENTS pages, or after a quiet spell, that is written out
+// as a new Segment, and small segments are merged so there are never many.
+// Adding a url again replaces its earlier document. search() ranks
+// documents by BM25 over all segments.
+struct SearchIndex
+{
+	std::string dir;
+	std::vector<std::shared_ptr<Segment>> segments;
+	MemorySegment memory;
+	uint32_t nextId;
+	uint32_t nextSegment;
+
+	// newest document per url; older ones are dead until merged away
+	struct Latest
+	{
+		uint32_t id;
+		uint32_t length;
+	};
+	std::unordered_map<std::string, Latest> latest;
+	std::unordered_set<uint32_t> dead;
+	uint64_t totalLength;
+	std::mutex mtx;
+
+	std::deque<std::pair<std::string, std::shared_ptr<const Page>>> queue;
+	std::mutex queueMtx;
+	std::condition_variable queueCondition;
+	std::condition_variable flushCondition;
+	size_t flushRequests;
+	size_t flushes;
+	bool stopping;
+	std::thread thread;
+
+	SearchIndex() : nextId(1), nextSegment(1), totalLength(0), flushRequests(0), flushes(0), stopping(false) {}
+	~SearchIndex();
+
+	bool open(const std::string& dir);
+	void close();
+	void add(const std::string& url, const std::shared_ptr<const Page>& page);
+	// waits until everything added so far is written to disk
+	void flush();
+	std::vector<SearchResult> search(const std::string& query, size_t limit);
+	size_t size();
+
+private:
+	void run();
+	void index(const std::string& url, const Page& page);
+	void remember(const std::string& url, uint32_t id, uint32_t length);
+	void writeMemory();
+	void merge();
+};
+
+// Shows results as a menu: a heading, then a link per result.
+void addResults(Page& page, const std::string& query, const std::vector<SearchResult>& results, double milliseconds);
@@ -0,0 +1,13 @@
+#include "link.h"
+#include <algorithm>
+
+const Link* findLink(const std::vector<Link>& links, int offset)
+{
+	auto i = std::upper_bound(links.begin(), links.end(), offset, [](int o, const Link& l) { return o < l.start; });
+	if(i == links.begin())
+		return 0;
+	--i;
+	if(offset >= i->end)
+		return 0;
+	return &*i;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// A clickable range of a text buffer, in character offsets.
+struct Link
+{
+	enum Type { LINK, SEARCH } type;
+	int start, end;
+	size_t item;
+};
+
+// Links are appended in buffer order, so a page's links are sorted by
+// offset and the one under a given offset is found by binary search.
+const Link* findLink(const std::vector<Link>& links, int offset);
@@ -1,6 +1,9 @@
+#include <atomic>
 #include <iostream>
 #include <memory.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <unistd.h>
 #include <netinet/tcp.h>
 #include <string>
 #include <vector>
@@ -8,9 +11,22 @@
 #include <thread>
 #include <mutex>
 #include <fstream>
+#include <unordered_map>
+#include "cache.h"
+#include "diskcache.h"
+#include "docview.h"
+#include "fd.h"
+#include "find.h"
+#include "gopher.h"
+#include "headless.h"
+#include "index.h"
 #include "net.h"
+#include "netpanel.h"
+#include "pagebuffer.h"
+#include "prefetch.h"
 #include "queue.h"
 #include "str.h"
+#include "timing.h"
 #include "worker.h"
 #include "ui.h"
 
@@ -23,19 +39,6 @@
 
 const std::string RES_PATH = stringify(RESOURCE_PATH);
 
-enum NodeType
-{
-	TYPE_DIR,
-	TYPE_INFO,
-	TYPE_FILE,
-	TYPE_BINARY,
-	TYPE_IMAGE,
-	TYPE_AUDIO,
-	TYPE_SEARCH,
-	TYPE_UNKNOWN,
-	TYPE_MAX,
-};
-
 enum Mode
 {
 	MODE_DIR,
@@ -43,34 +46,31 @@ enum Mode
 	MODE_BINARY,
 };
 
-struct Node
-{
-	int type = TYPE_UNKNOWN;
-	char code;
-	std::string text;
-	std::string path;
-	std::string host;
-	std::string port;
-	std::string url;
-	int start, end;
-};
-
 struct History
 {
 	std::string url;
 };
 
-struct Link
-{
-	enum Type { LINK, SEARCH } type;
-	int start, end;
-	std::string url;
-};
-
 const size_t npos = std::string::npos;
 const char* HOME = "gopher://gopher.quux.org";
-
-std::vector<Node> nodes;
+const size_t PAGE_CACHE_SIZE = 64 * 0x100000;
+const size_t DISK_CACHE_SIZE = 256 * 0x100000;
+const int DISK_CACHE_FRESH = 300;
+const size_t LARGE_PAGE_ITEMS = 5000;
+const size_t LARGE_PAGE_BYTES = 0x100000;
+const size_t MAX_PREFETCHES = 4;
+const size_t MAX_HOST_PREFETCHES = 2;
+const size_t DOWNLOAD_RATE_LIMIT = 0x100000;
+const size_t SEARCH_RESULTS = 100;
+
+std::shared_ptr<Page> page(new Page);
+PageCache pageCache(PAGE_CACHE_SIZE);
+DiskCache diskCache(DISK_CACHE_SIZE);
+SearchIndex searchIndex;
+bool revalidate = true;
+std::shared_ptr<Page> freshPage;
+Prefetcher prefetcher(pageCache, MAX_PREFETCHES, MAX_HOST_PREFETCHES);
+size_t shown = 0;
 std::vector<Link> links;
 
 std::vector<History> history;
@@ -80,6 +80,9 @@ std::string location;
 int displayType = TYPE_DIR;
 
 MessageQueue dataQueue;
+int queueEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+std::atomic<bool> queueSignalled(false);
+guint renderTick = 0;
 
 class SearchDialog;
 
@@ -88,95 +91,33 @@ std::unique_ptr<Window> w;
 std::unique_ptr<SearchDialog> searchDialog;
 
 TextView* view = 0;
+ScrolledWindow* scroll = 0;
+DocView* docView = 0;
+StatusBar* statusBar = 0;
+NetworkPanel* networkPanel = 0;
+GdkCursor* handCursor = 0;
+GdkCursor* textCursor = 0;
+size_t hoveredItem = npos;
+bool virtualized = false;
 Edit* address = 0;
 int currentRequest = 0;
-std::string data;
-std::string incompleteData;
+std::unordered_map<int, std::string> downloads;
+MenuParser menuParser;
+TextParser textParser;
+Finder finder;
+Box* findBar = 0;
+Edit* findText = 0;
+CheckButton* matchCase = 0;
+Label* findStatus = 0;
 
 GdkPixbuf* icons[TYPE_MAX];
+BufferStyle bufferStyle = { 0, 0, icons, 0, 0 };
 
 const char* userHome()
 {
 	return getenv("HOME");
 }
 
-int docType(int code)
-{
-	switch(code)
-	{
-	case 'i':
-		return TYPE_INFO;
-	case '1':
-		return TYPE_DIR;
-	case '0':
-		return TYPE_FILE;
-	case '4':
-	case '5':
-	case '6':
-	case '9':
-		return TYPE_BINARY;
-	case 'g':
-	case 'I':
-		return TYPE_IMAGE;
-	case 's':
-		return TYPE_AUDIO;
-	case '7':
-		return TYPE_SEARCH;
-	default:
-		return TYPE_UNKNOWN;
-	}
-}
-
-void parseList(const std::string& data, std::vector<Node>& nodes)
-{
-	if(!nodes.size())
-	{
-		Node blank;
-		blank.type = TYPE_INFO;
-		blank.code = 'i';
-		blank.text = "\n";
-		nodes.push_back(blank);
-	}
-	std::vector<std::string> lines;
-	splitLines(data, lines);
-	for(std::string& line : lines)
-	{
-		if(line.size() > 1)
-		{
-			Node n;
-			n.type = TYPE_INFO;
-			char c = line[0];
-			n.code = c;
-			n.type = docType(c);
-			std::vector<std::string> parts;
-			line.erase(0, 1);
-			while(line.size())
-			{
-				auto i = line.find('\t');
-				parts.push_back(line.substr(0, i));
-				if(i == std::string::npos)
-					line.clear();
-				else
-					line.erase(0, i+1);
-			}
-			if((n.type != TYPE_INFO) && parts.size() >= 4)
-			{
-				n.path = parts[1];
-				if(n.path[0] != '/')
-					n.path.insert(0, "/");
-				n.host = parts[2];
-				n.port = strip(parts[3]);
-				if(n.port != "70")
-					n.url = "gopher://"+(n.host + ":" + n.port + "/" + n.code + n.path);
-				else
-					n.url = "gopher://"+(n.host + "/" + n.code + n.path);
-			}
-			n.text = parts[0] + "\n";
-			nodes.push_back(n);
-		}
-	}
-}
-
 std::string filetype(const std::string& path)
 {
 	auto i = path.rfind(".");
@@ -185,46 +126,69 @@ std::string filetype(const std::string& path)
 	return path.substr(i);
 }
 
-void showText(const std::string& data, std::vector<Node>& nodes)
-{
-	if(!nodes.size())
-	{
-		Node blank;
-		blank.type = TYPE_INFO;
-		blank.code = 'i';
-		blank.text = "\n";
-		nodes.push_back(blank);
-	}
-	std::vector<std::string> lines;
-	splitLines(data, lines);
-	for(auto& l : lines)
-	{
-		Node n;
-		n.type = TYPE_INFO;
-		n.text = l + "\n";
-		nodes.push_back(n);
-	}
-}
-
-void showNodes(TextView* view, const std::vector<Node>& nodes);
+void showNodes(TextView* view);
+void useDocView(bool use);
+void hoverItem(size_t item);
 
 void showMessage(const std::string& data)
 {
-	nodes.clear();
+	useDocView(false);
+	page.reset(new Page);
+	shown = 0;
 	links.clear();
-	showText(data, nodes);
-	showNodes(view, nodes);
+	finder.restart();
+	page->addBlank();
+	page->addText(data);
+	showNodes(view);
 }
 
-void queueData(const Message& m)
+void queueData(Message&& m)
 {
-	dataQueue.push(m);
+	dataQueue.push(std::move(m));
+	if(!queueSignalled.exchange(true))
+	{
+		uint64_t one = 1;
+		if(write(queueEvent, &one, sizeof(one)) == -1)
+			std::cerr << "Failed to signal UI: " << strerror(errno) << "\n";
+	}
 }
 
-void go(const char* url, bool addToHistory = true, bool clearFuture = true)
+// Builds a page from the disk cache. An entry older than DISK_CACHE_FRESH
+// is only used if it can be revalidated in the background, which stale
+// is set to signal.
+std::shared_ptr<Page> loadCached(const std::string& key, int type, bool& stale)
+{
+	std::shared_ptr<Page> cached;
+	auto file = diskCache.get(key);
+	if(!file)
+		return cached;
+	stale = time(0) - file->stored > DISK_CACHE_FRESH;
+	if(stale && !revalidate)
+		return cached;
+	cached.reset(new Page);
+	cached->addBlank();
+	if(type == TYPE_DIR || type == TYPE_SEARCH)
+		parseList(file->data, file->size, *cached);
+	else
+		parseText(file->data, file->size, *cached);
+	pageCache.put(key, cached);
+	return cached;
+}
+
+void go(const char* url, bool addToHistory = true, bool clearFuture = true, bool reload = false)
 {
 	view->clear();
-	data = "";
+	useDocView(false);
+	hoverItem(npos);
+	statusBar->setText("timing", "");
+	page.reset(new Page);
+	shown = 0;
+	links.clear();
+	finder.restart();
+	freshPage.reset();
+	menuParser.reset();
+	textParser.reset();
+	cancel(currentRequest);
 	if(addToHistory)
 	{
 		if(history.size() && clearFuture)
@@ -235,8 +199,6 @@ void go(const char* url, bool addToHistory = true, bool clearFuture = true)
 		history.push_back({url});
 	}
 	address->setText(url);
-	nodes.clear();
-	links.clear();
 	std::string addr = url;
 	if(addr.find("gopher://")==0)
 	{
@@ -271,15 +233,51 @@ void go(const char* url, bool addToHistory = true, bool clearFuture = true)
 		path.erase(0, path.find("/")+1);
 		path.erase(0, path.rfind("/")+1);
 		path = std::string(userHome())+"/Downloads/"+path;
-		download(url, strip(path));
+		downloads[download(url, strip(path))] = url;
 		showMessage(std::string("Downloading ") + url + " to " + path);
 	}
 	else
 	{
 		location = url;
 		address->setText(location);
-		fetch(++currentRequest, location, type);
 		displayType = type;
+		currentRequest = newRequest();
+		std::string key = normalizeUrl(location);
+		std::shared_ptr<Page> cached;
+		bool stale = false;
+		Prefetcher::Request prefetched;
+		if(!reload)
+		{
+			cached = pageCache.get(key);
+			if(!cached)
+				cached = loadCached(key, type, stale);
+		}
+		if(cached)
+		{
+			page = cached;
+			showNodes(view);
+			if(stale)
+			{
+				freshPage.reset(new Page);
+				freshPage->addBlank();
+				fetch(currentRequest, location, type);
+			}
+		}
+		else if(!reload && prefetcher.adopt(key, currentRequest, prefetched))
+		{
+			// already on its way; carry on from where the prefetch got to
+			prioritize(currentRequest, FOREGROUND);
+			page = prefetched.page;
+			menuParser = prefetched.menuParser;
+			textParser = prefetched.textParser;
+			showNodes(view);
+		}
+		else
+		{
+			fetch(currentRequest, location, type);
+			page->addBlank();
+		}
+		prefetcher.cancel();
 	}
 }
 
@@ -309,6 +307,12 @@ void forwardClick()
 	}
 }
 
+void reloadClick()
+{
+	if(location != "")
+		go(location.c_str(), false, true, true);
+}
+
 void upClick()
 {
 	std::string addr = location;
@@ -330,9 +334,39 @@ void upClick()
 	go(target.c_str());
 }
 
+// Shows the visited pages best matching query as a menu.
+void searchPages(const std::string& query)
+{
+	view->clear();
+	useDocView(false);
+	hoverItem(npos);
+	cancel(currentRequest);
+	currentRequest = newRequest();
+	freshPage.reset();
+	prefetcher.cancel();
+	page.reset(new Page);
+	shown = 0;
+	links.clear();
+	finder.restart();
+	location = "";
+	displayType = TYPE_DIR;
+	int64_t start = steadyMicroseconds();
+	auto results = searchIndex.search(query, SEARCH_RESULTS);
+	double ms = (steadyMicroseconds() - start) / 1000.0;
+	addResults(*page, query, results, ms);
+	statusBar->setText("timing", std::to_string(searchIndex.size()) + " pages indexed");
+	showNodes(view);
+}
+
+// "?words" searches visited pages; anything else is a url.
 void addressBarEnter()
 {
 	std::string addr = address->text();
+	if(addr.size() && addr[0] == '?')
+	{
+		searchPages(addr.substr(1));
+		return;
+	}
 	if(addr.find("gopher://") != 0)
 		addr = "gopher://" + addr;
 	go(addr.c_str());
@@ -409,73 +443,241 @@ struct SearchDialog : public Widget
 	}
 };
 
+void openItem(size_t item)
+{
+	std::string url = page->url(item);
+	if(page->types[item] == TYPE_SEARCH)
+	{
+		searchDialog.reset(new SearchDialog(url));
+	}
+	else
+	{
+		go(url.c_str());
+	}
+}
+
 void tagEvent(GtkTextTag* tag, GObject* o, GdkEvent* event, GtkTextIter* iter, gpointer data)
 {
 	if(event->type == GDK_BUTTON_PRESS)
 	{
-		int offset = gtk_text_iter_get_offset(iter);
-		for(auto& l : links)
+		auto link = findLink(links, gtk_text_iter_get_offset(iter));
+		if(link && page->hasUrl(link->item))
+			openItem(link->item);
+	}
+}
+
+// Shows the url of the item under the pointer, or clears it for npos.
+void hoverItem(size_t item)
+{
+	if(item == hoveredItem)
+		return;
+	hoveredItem = item;
+	statusBar->setText("link", item != npos ? page->url(item) : "");
+	if(item != npos)
+	{
+		prefetcher.want(*page, item, true);
+		prefetcher.pump();
+	}
+}
+
+gboolean viewMotion(GtkWidget* widget, GdkEventMotion* event, gpointer data)
+{
+	auto textView = GTK_TEXT_VIEW(widget);
+	int x, y;
+	gtk_text_view_window_to_buffer_coords(textView, GTK_TEXT_WINDOW_WIDGET, event->x, event->y, &x, &y);
+	GtkTextIter iter;
+	const Link* link = 0;
+	if(gtk_text_view_get_iter_at_location(textView, &iter, x, y))
+		link = findLink(links, gtk_text_iter_get_offset(&iter));
+	size_t item = link && page->hasUrl(link->item) ? link->item : npos;
+	if(item != hoveredItem)
+		gdk_window_set_cursor(gtk_text_view_get_window(textView, GTK_TEXT_WINDOW_TEXT), item != npos ? handCursor : textCursor);
+	hoverItem(item);
+	return false;
+}
+
+// The items on screen, [first, last).
+void visibleItems(size_t& first, size_t& last)
+{
+	if(virtualized)
+		docView->visibleRange(first, last);
+	else
+	{
+		auto textView = GTK_TEXT_VIEW(view->handle);
+		GdkRectangle rect;
+		gtk_text_view_get_visible_rect(textView, &rect);
+		GtkTextIter iter;
+		gtk_text_view_get_line_at_y(textView, &iter, rect.y, 0);
+		first = gtk_text_iter_get_line(&iter);
+		gtk_text_view_get_line_at_y(textView, &iter, rect.y + rect.height, 0);
+		last = std::min(size_t(gtk_text_iter_get_line(&iter)) + 1, page->size());
+	}
+}
+
+// Offers the items on screen to the prefetcher.
+void prefetchVisible()
+{
+	if(!prefetcher.enabled || !page->size())
+		return;
+	size_t first, last;
+	visibleItems(first, last);
+	for(size_t i = first; i < last; ++i)
+		prefetcher.want(*page, i);
+	prefetcher.pump();
+}
+
+bool finding()
+{
+	return gtk_widget_get_visible(findBar->handle) && finder.needle.size();
+}
+
+// The DocView draws its own highlights; the TextView's are tags, put on
+// the lines on screen whenever they change.
+void highlightMatches()
+{
+	if(virtualized)
+	{
+		docView->setFinder(finding() ? &finder : 0);
+		return;
+	}
+	size_t first = 0, last = 0;
+	if(finding())
+		visibleItems(first, last);
+	tagMatches(view->buffer, bufferStyle, *page, finder, first, std::min(last, shown));
+}
+
+void showFindStatus()
+{
+	if(!finding())
+		findStatus->setText("");
+	else if(finder.matches.empty())
+		findStatus->setText("No matches");
+	else
+		findStatus->setText(std::to_string(finder.current + 1) + " of " + std::to_string(finder.matches.size()));
+}
+
+// Scrolls the current match, if any, into view.
+void showMatch()
+{
+	if(finder.matches.size())
+	{
+		auto& m = finder.matches[finder.current];
+		if(virtualized)
+			docView->scrollTo(m.item);
+		else if(m.item < shown)
 		{
-			if(l.url == "")
-				continue;
-			if(offset >= l.start && offset < l.end)
-			{
-				if(l.type == Link::SEARCH)
-				{
-					searchDialog.reset(new SearchDialog(l.url));
-				}
-				else
-				{
-					std::string url = l.url;
-					go(url.c_str());
-				}
-				break;
-			}
+			GtkTextIter iter;
+			itemIter(view->buffer, bufferStyle, *page, m.item, m.start, &iter);
+			gtk_text_view_scroll_to_iter(GTK_TEXT_VIEW(view->handle), &iter, 0, true, 0, 0.5);
 		}
 	}
+	highlightMatches();
+	showFindStatus();
 }
 
-void addText(GtkTextBuffer* buffer, const std::string& text)
+// Searches afresh as the text changes, starting from the first match on
+// screen.
+void findChanged()
 {
-	GtkTextIter end;
-	gtk_text_buffer_get_iter_at_offset(view->buffer, &end, -1);
-	gtk_text_buffer_insert(view->buffer, &end, text.c_str(), text.size());
+	finder.start(findText->text(), !matchCase->active());
+	if(finding())
+	{
+		finder.update(*page);
+		size_t first, last;
+		visibleItems(first, last);
+		size_t k = finder.firstFrom(first);
+		finder.current = k < finder.matches.size() ? k : 0;
+	}
+	showMatch();
 }
 
-void addLink(GtkTextBuffer* buffer, const std::string& text, const std::string& url, GdkPixbuf* icon = 0, Link::Type type = Link::LINK)
+void findNext()
 {
-	auto link = gtk_text_tag_table_lookup(gtk_text_buffer_get_tag_table(view->buffer), "link");
+	finder.next();
+	showMatch();
+}
 
-	GtkTextIter end;
-	gtk_text_buffer_get_iter_at_offset(view->buffer, &end, -1);
-	int startOffset = gtk_text_iter_get_offset(&end);
+void findPrevious()
+{
+	finder.previous();
+	showMatch();
+}
 
-	if(icon)
-	{
-		auto iconTag = gtk_text_tag_table_lookup(gtk_text_buffer_get_tag_table(view->buffer), "icon");
-		gtk_text_buffer_insert_pixbuf(view->buffer, &end, icon);
+void showFindBar()
+{
+	findBar->setVisible(true);
+	gtk_widget_grab_focus(findText->handle);
+	findChanged();
+}
 
-		GtkTextIter start;
-		gtk_text_buffer_get_iter_at_offset(view->buffer, &start, startOffset);
+void hideFindBar()
+{
+	findBar->setVisible(false);
+	highlightMatches();
+	showFindStatus();
+}
 
-		gtk_text_buffer_get_iter_at_offset(view->buffer, &end, -1);
-		gtk_text_buffer_apply_tag(view->buffer, iconTag, &start, &end);
+gboolean windowKey(GtkWidget* widget, GdkEventKey* event, gpointer data)
+{
+	bool control = event->state & GDK_CONTROL_MASK;
+	bool shift = event->state & GDK_SHIFT_MASK;
+	if(control && event->keyval == GDK_KEY_f)
+		showFindBar();
+	else if(finding() && (event->keyval == GDK_KEY_F3 || (control && event->keyval == GDK_KEY_g)))
+		shift ? findPrevious() : findNext();
+	else if(finding() && control && event->keyval == GDK_KEY_G)
+		findPrevious();
+	else if(event->keyval == GDK_KEY_Escape && gtk_widget_get_visible(findBar->handle))
+		hideFindBar();
+	else
+		return false;
+	return true;
+}
+
+void viewScrolled(GtkAdjustment* adjustment, gpointer data)
+{
+	prefetchVisible();
+	if(!virtualized && finding())
+		highlightMatches();
+}
+
+// Pages past LARGE_PAGE_ITEMS or LARGE_PAGE_BYTES are handed to the DocView,
+// which only lays out what is on screen; smaller ones stay in the TextView.
+void useDocView(bool use)
+{
+	if(use == virtualized)
+		return;
+	virtualized = use;
+	scroll->setVisible(!use);
+	docView->setVisible(use);
+	if(use)
+	{
+		view->clear();
+		links.clear();
 	}
-	gtk_text_buffer_insert(view->buffer, &end, "    ", 4);
-	gtk_text_buffer_get_iter_at_offset(view->buffer, &end, -1);
-	int linkOffset = gtk_text_iter_get_offset(&end);
-	gtk_text_buffer_insert_with_tags(view->buffer, &end, text.c_str(), text.size(), link, nullptr);
-	links.push_back({type, linkOffset, linkOffset+int(text.size()-1), url});
+	else
+		docView->clear();
 }
 
-void showNodes(TextView* view, const std::vector<Node>& nodes)
+void showNodes(TextView* view)
 {
-	for(auto& n : nodes)
+	if(!virtualized && (page->size() > LARGE_PAGE_ITEMS || page->received > LARGE_PAGE_BYTES))
+		useDocView(true);
+	if(virtualized)
 	{
-		if(n.type == TYPE_INFO)
-			addText(view->buffer, n.text);
+		if(docView->page() != page)
+			docView->setPage(page, displayType == TYPE_DIR || displayType == TYPE_SEARCH);
 		else
-			addLink(view->buffer, n.text, n.url, icons[n.type], n.type == TYPE_SEARCH? Link::SEARCH : Link::LINK);
+			docView->update();
+	}
+	else
+		appendItems(view->buffer, bufferStyle, *page, shown, page->size(), links);
+	shown = page->size();
+	if(finding())
+	{
+		finder.update(*page);
+		highlightMatches();
+		showFindStatus();
 	}
 }
 
@@ -497,7 +699,7 @@ void save()
 	{
 		std::string filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(save));
 		std::ofstream file(filename.c_str());
-		file.write(data.c_str(), data.size());
+		file.write(page->bytes.data(), page->received);
 	}
 	gtk_widget_destroy(GTK_WIDGET(save));
 }
@@ -542,6 +744,46 @@ void activate()
 	fileMi->addMenu(fileMenu);
 	quitMi->onActivate(quit);
 
+	auto optionsMenu = new Menu();
+	auto optionsMi = menubar->add(new MenuItem("Options"));
+	auto revalidateMi = new CheckMenuItem("Revalidate cached pages", revalidate);
+	optionsMenu->add(revalidateMi);
+	revalidateMi->onActivate([revalidateMi](){
+		revalidate = revalidateMi->active();
+	});
+	auto prefetchMi = new CheckMenuItem("Prefetch links", prefetcher.enabled);
+	optionsMenu->add(prefetchMi);
+	prefetchMi->onActivate([prefetchMi](){
+		prefetcher.enabled = prefetchMi->active();
+		if(prefetcher.enabled)
+			prefetchVisible();
+		else
+			prefetcher.cancel();
+	});
+	auto limitMi = new CheckMenuItem("Limit downloads to 1 MiB/s");
+	optionsMenu->add(limitMi);
+	limitMi->onActivate([limitMi](){
+		limitBackground(limitMi->active() ? DOWNLOAD_RATE_LIMIT : 0);
+	});
+	optionsMi->addMenu(optionsMenu);
+
+	auto viewMenu = new Menu();
+	auto viewMi = menubar->add(new MenuItem("View"));
+	auto networkMi = viewMenu->add(new MenuItem("Network"));
+	networkMi->onActivate([](){
+		networkPanel->show();
+	});
+	auto findMi = viewMenu->add(new MenuItem("Find in page"));
+	findMi->onActivate(showFindBar);
+	auto searchMi = viewMenu->add(new MenuItem("Search visited pages"));
+	searchMi->onActivate([](){
+		address->setText("?");
+		gtk_widget_grab_focus(address->handle);
+		gtk_editable_set_position(GTK_EDITABLE(address->handle), -1);
+	});
+	viewMi->addMenu(viewMenu);
+	networkPanel = new NetworkPanel(w.get());
+
 	Box* addressBar = main->insert(new Box(Box::HORIZONTAL));
 	Button* back = addressBar->insert(new Button("Back"), false, false);
 	back->onClick(backClick);
@@ -549,13 +791,32 @@ void activate()
 	forward->onClick(forwardClick);
 	Button* up = addressBar->insert(new Button("Up"), false, false);
 	up->onClick(upClick);
+	Button* reload = addressBar->insert(new Button("Reload"), false, false);
+	reload->onClick(reloadClick);
 	address = addressBar->insert(new Edit, true, true);
 	address->onActivate(addressBarEnter);
 	Button* goURL = addressBar->push(new Button("Go"), false, false);
 	goURL->onClick(goClick);
 
-	auto scroll = new ScrolledWindow();
+	statusBar = main->push(new StatusBar());
+	findBar = main->push(new Box(Box::HORIZONTAL, 4));
+	findBar->insert(new Label("Find:"), false, false, 4);
+	findText = findBar->insert(new Edit, true, true);
+	findText->onChange(findChanged);
+	findText->onActivate(findNext);
+	Button* previousMatch = findBar->insert(new Button("Previous"), false, false);
+	previousMatch->onClick(findPrevious);
+	Button* nextMatch = findBar->insert(new Button("Next"), false, false);
+	nextMatch->onClick(findNext);
+	matchCase = findBar->insert(new CheckButton("Match case"), false, false);
+	matchCase->onToggle(findChanged);
+	findStatus = findBar->insert(new Label(""), false, false, 4);
+	g_signal_connect(w->handle, "key-press-event", G_CALLBACK(windowKey), 0);
+	scroll = new ScrolledWindow();
 	main->push(scroll, true, true);
+	docView = main->push(new DocView(icons), true, true);
+	docView->onActivate(openItem);
+	docView->onHover(hoverItem);
 
 	view = scroll->add(new TextView());
 	gtk_text_view_set_left_margin(GTK_TEXT_VIEW(view->handle), 20);
@@ -563,18 +824,37 @@ void activate()
 	view->setEditable(false);
 	view->showCursor(false);
 	w->showAll();
+	docView->setVisible(false);
+	findBar->setVisible(false);
 
 	GdkRGBA blue = {0, 0, 1, 1} ;
-	gtk_text_buffer_create_tag(view->buffer, "icon",
+	bufferStyle.icon = gtk_text_buffer_create_tag(view->buffer, "icon",
 		"rise", -7 * PANGO_SCALE,
 		"rise-set", true,
 		nullptr);
-	auto link = gtk_text_buffer_create_tag(view->buffer, "link",
+	bufferStyle.link = gtk_text_buffer_create_tag(view->buffer, "link",
 		"underline", true,
 		"foreground-rgba", &blue,
 		nullptr);
+	GdkRGBA yellow = {1, 1, 0.4, 1};
+	GdkRGBA orange = {1, 0.6, 0.2, 1};
+	bufferStyle.match = gtk_text_buffer_create_tag(view->buffer, "match",
+		"background-rgba", &yellow,
+		nullptr);
+	bufferStyle.currentMatch = gtk_text_buffer_create_tag(view->buffer, "current-match",
+		"background-rgba", &orange,
+		nullptr);
 
-	g_signal_connect(link, "event", G_CALLBACK(tagEvent), 0);
+	g_signal_connect(bufferStyle.link, "event", G_CALLBACK(tagEvent), 0);
+	gtk_widget_add_events(view->handle, GDK_POINTER_MOTION_MASK);
+	g_signal_connect(view->handle, "motion-notify-event", G_CALLBACK(viewMotion), 0);
+	handCursor = gdk_cursor_new_from_name(gdk_display_get_default(), "pointer");
+	textCursor = gdk_cursor_new_from_name(gdk_display_get_default(), "text");
+	for(auto adjustment : { gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(scroll->handle)), docView->adjustment() })
+	{
+		g_signal_connect(adjustment, "value-changed", G_CALLBACK(viewScrolled), 0);
+		g_signal_connect(adjustment, "changed", G_CALLBACK(viewScrolled), 0);
+	}
 
 	icons[TYPE_DIR] = loadImage("icons/directory.png");
 	icons[TYPE_FILE] = loadImage("icons/text.png");
@@ -592,55 +872,148 @@ void activate()
 	}
 }
 
-void popQueue(std::vector<Node>& nodes)
+// Records a finished or failed request in the network panel, and in the
+// status bar if it was for the page being viewed.
+void logRequest(const Message& m)
 {
-	if(!dataQueue.size())
-		return;
-	auto m = dataQueue.pop();
+	std::string url;
 	if(m.reqid == currentRequest)
 	{
+		url = location;
+		std::string status = describe(m.timing);
+		if(m.type == Message::ERROR)
+			status = "Failed: " + m.data + ", " + status;
+		statusBar->setText("timing", status);
+	}
+	else if(downloads.count(m.reqid))
+		url = downloads[m.reqid];
+	else
+	{
+		auto i = prefetcher.active.find(m.reqid);
+		if(i == prefetcher.active.end())
+			return;
+		url = i->second.target.url;
+	}
+	networkPanel->add(url, m.timing, m.type == Message::ERROR);
+}
+
+void popQueue(Message& m)
+{
+	if(m.type != Message::DATA)
+		logRequest(m);
+	if(m.reqid == currentRequest)
+	{
+		// while revalidating, the cached copy stays on screen and the
+		// response is parsed on the side
+		Page& target = freshPage ? *freshPage : *page;
+		bool menu = displayType == TYPE_DIR || displayType == TYPE_SEARCH;
 		if(m.type == Message::DATA)
 		{
-			std::string completeData;
-			incompleteData += m.data;
-			auto end = incompleteData.rfind("\n");
-			completeData = incompleteData.substr(0, end);
-			incompleteData = incompleteData.substr(end+1);
-
-			data += completeData;
-			if(displayType == TYPE_DIR || displayType == TYPE_SEARCH)
-			{
-				parseList(completeData, nodes);
-			}
+			if(menu)
+				menuParser.feed(target, m.slice.data(), m.slice.size);
+			else
+				textParser.feed(target, m.slice.data(), m.slice.size);
+		}
+		else if(m.type == Message::FINISHED)
+		{
+			if(menu)
+				menuParser.finish(target);
 			else
+				textParser.finish(target);
+			if(freshPage)
 			{
-				showText(completeData, nodes);
+				if(freshPage->received != page->received || freshPage->bytes.compare(0, freshPage->received, page->bytes, 0, page->received))
+				{
+					page = freshPage;
+					view->clear();
+					shown = 0;
+					links.clear();
+					finder.restart();
+				}
+				freshPage.reset();
 			}
+			std::string key = normalizeUrl(location);
+			pageCache.put(key, page);
+			diskCache.put(key, page->bytes.data(), page->received);
+			searchIndex.add(key, page);
+			prefetchVisible();
 		}
 		else if(m.type == Message::ERROR)
 		{
-			showText(m.data, nodes);
+			// logRequest has already shown the failure in the status bar
+			// and the network panel; the cached copy stays
+			if(freshPage)
+				freshPage.reset();
+			else
+				page->addText(m.data);
 		}
 	}
+	else if(downloads.erase(m.reqid))
+		return;
+	// anything else was queued before its page or prefetch was cancelled
 	else
-		std::cout << "discarded " << m.data.size() << " bytes from req " << m.reqid << "\n";
+		prefetcher.receive(m);
 }
 
-int idle(void*)
+gboolean render(GtkWidget* widget, GdkFrameClock* clock, gpointer)
+{
+	showNodes(view);
+	renderTick = 0;
+	return G_SOURCE_REMOVE;
+}
+
+// A GSource that dispatches whenever the worker has queued messages. The
+// worker signals queueEvent once per batch; items parsed from the batch are
+// shown on the next frame, so a burst of chunks costs a single repaint.
+struct QueueSource
+{
+	GSource source;
+	gpointer tag;
+};
+
+gboolean queuePrepare(GSource* source, gint* timeout)
 {
-	if(!dataQueue.size())
-		return 1;
-	std::vector<Node> nodes;
-	while(dataQueue.size())
+	*timeout = -1;
+	return dataQueue.size() > 0;
+}
+
+gboolean queueCheck(GSource* source)
+{
+	auto q = reinterpret_cast<QueueSource*>(source);
+	return (g_source_query_unix_fd(source, q->tag) & G_IO_IN) || dataQueue.size() > 0;
+}
+
+gboolean queueDispatch(GSource* source, GSourceFunc callback, gpointer data)
+{
+	uint64_t count;
+	while(read(queueEvent, &count, sizeof(count)) > 0);
+	queueSignalled = false;
+
+	std::vector<Message> messages;
+	dataQueue.popAll(messages);
+	for(auto& m : messages)
 	{
-		popQueue(nodes);
+		popQueue(m);
 	}
-	showNodes(view, nodes);
-	return 1;
+	if(shown < page->size() && !renderTick)
+		renderTick = gtk_widget_add_tick_callback(view->handle, render, 0, 0);
+	return G_SOURCE_CONTINUE;
+}
+
+GSourceFuncs queueFuncs = { queuePrepare, queueCheck, queueDispatch, 0 };
+
+void watchQueue()
+{
+	GSource* source = g_source_new(&queueFuncs, sizeof(QueueSource));
+	auto q = reinterpret_cast<QueueSource*>(source);
+	q->tag = g_source_add_unix_fd(source, queueEvent, G_IO_IN);
+	g_source_attach(source, 0);
+	g_source_unref(source);
 }
 
 void cleanup()
 {
+	searchIndex.close();
 	for(auto p : icons)
 	{
 		if(p) g_object_unref(p);
@@ -649,11 +1022,15 @@ void cleanup()
 
 int main(int argc, char** argv)
 {
+	if(headlessRequested(argc, argv))
+		return runHeadless(argc, argv);
+	if(diskCache.open())
+		searchIndex.open(diskCache.dir + "/index");
 	app.reset(new Application("test.app", 0));
 	app->onActivate(activate);
 
-	std::thread worker(runWorker);
-	g_timeout_add(10, idle, 0);
+	std::thread worker = startWorker();
+	watchQueue();
 	int status = app->run(argc, argv);
 	endWorker();
 	worker.join();
@@ -0,0 +1,407 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fd.h"
+#include "gopher.h"
+#include "headless.h"
+#include "mirror.h"
+#include "queue.h"
+#include "timing.h"
+#include "worker.h"
+
+const int DEFAULT_MIRROR_JOBS = 16;
+const int DEFAULT_DEPTH = 3;
+const int DEFAULT_PER_HOST = 2;
+const char* JOURNAL_NAME = ".ferret-mirror";
+const int PROGRESS_INTERVAL = 1000;
+
+namespace
+{
+	struct Entry
+	{
+		std::string url;
+		int depth;
+	};
+
+	// A request in flight. Menus are written out and parsed as they arrive;
+	// everything else is saved by the worker.
+	struct Transfer
+	{
+		Entry entry;
+		std::string host;
+		bool menu;
+		UniqueFd file;
+		Page page;
+		MenuParser parser;
+	};
+
+	void usage()
+	{
+		std::cerr << "usage: ferret --mirror <url> [-o directory] [-j N] [--depth D] [--per-host N] [--any-host]\n";
+	}
+
+	// the host and port of a normalized url
+	std::string hostOf(const std::string& url)
+	{
+		size_t sl = url.find('/', 9);
+		return url.substr(9, sl - 9);
+	}
+
+	// whether host can be used as a directory name under the root
+	bool safeHost(const std::string& host)
+	{
+		return host.size() && host != "." && host != ".." && host.find('/') == std::string::npos;
+	}
+
+	// gopher://host:7070/1/a/../b maps to <root>/host:7070/a/b/gophermap
+	std::string localPath(const std::string& root, const std::string& url, bool menu)
+	{
+		std::string base = root + "/" + hostOf(url);
+		std::string selector = url.substr(url.find('/', 9) + 2);
+		selector = selector.substr(0, selector.find('\t'));
+		std::string path = base;
+		for(size_t i = 0; i <= selector.size();)
+		{
+			size_t end = selector.find('/', i);
+			if(end == std::string::npos)
+				end = selector.size();
+			std::string part = selector.substr(i, end - i);
+			if(part.size() && part != "." && part != "..")
+			{
+				for(auto& c : part)
+				{
+					if(c > 0 && c < ' ')
+						c = '_';
+				}
+				path += "/" + part;
+			}
+			i = end + 1;
+		}
+		if(menu)
+			path += "/gophermap";
+		else if(path == base || selector.back() == '/')
+			path += "/index";
+		return path;
+	}
+
+	bool makeParents(const std::string& path)
+	{
+		for(size_t i = path.find('/', 1); i != std::string::npos; i = path.find('/', i+1))
+		{
+			if(mkdir(path.substr(0, i).c_str(), 0755) == -1 && errno != EEXIST)
+				return false;
+		}
+		return true;
+	}
+
+	bool followed(int type)
+	{
+		return type == TYPE_DIR || type == TYPE_FILE || type == TYPE_BINARY || type == TYPE_IMAGE || type == TYPE_AUDIO;
+	}
+
+	struct Mirror
+	{
+		std::string root;
+		int jobs = DEFAULT_MIRROR_JOBS;
+		int depth = DEFAULT_DEPTH;
+		int perHost = DEFAULT_PER_HOST;
+		bool anyHost = false;
+		std::string startHost;
+
+		std::unordered_set<std::string> seen;
+		// per host, in the order found, so each host is crawled breadth-first
+		std::unordered_map<std::string, std::deque<Entry>> queued;
+		std::list<std::string> hosts;
+		std::unordered_map<std::string, int> busy;
+		std::unordered_map<int, std::unique_ptr<Transfer>> active;
+		FILE* journal = 0;
+		size_t pending = 0, menus = 0, files = 0, failed = 0, bytes = 0;
+
+		bool resume();
+		void add(const Entry& e, bool record);
+		void start();
+		bool launch(const Entry& e);
+		void receive(Message& m);
+		void done(const Transfer& t, bool ok, const std::string& error);
+	};
+
+	// Replays the journal: every url it queued is seen, and those not
+	// marked done are queued again. Failed ones are retried.
+	bool Mirror::resume()
+	{
+		std::ifstream in(root + "/" + JOURNAL_NAME);
+		if(!in)
+			return false;
+		std::vector<Entry> found;
+		std::unordered_set<std::string> finished;
+		std::string line;
+		while(std::getline(in, line))
+		{
+			if(line.size() < 3)
+				continue;
+			if(line[0] == 'Q')
+			{
+				size_t space = line.find(' ', 2);
+				if(space == std::string::npos)
+					continue;
+				Entry e = { line.substr(space+1), atoi(line.c_str() + 2) };
+				if(seen.insert(e.url).second)
+					found.push_back(e);
+			}
+			else if(line[0] == 'D')
+				finished.insert(line.substr(2));
+		}
+		for(auto& e : found)
+		{
+			if(!finished.count(e.url))
+				add(e, false);
+		}
+		std::cerr << "Resuming: " << finished.size() << " done, " << pending << " to go\n";
+		return true;
+	}
+
+	void Mirror::add(const Entry& e, bool record)
+	{
+		if(record)
+			fprintf(journal, "Q %d %s\n", e.depth, e.url.c_str());
+		std::string host = hostOf(e.url);
+		auto& q = queued[host];
+		if(q.empty())
+			hosts.push_back(host);
+		q.push_back(e);
+		++pending;
+	}
+
+	void Mirror::start()
+	{
+		for(auto h = hosts.begin(); h != hosts.end() && active.size() < size_t(jobs);)
+		{
+			auto& q = queued[*h];
+			while(q.size() && busy[*h] < perHost && active.size() < size_t(jobs))
+			{
+				Entry e = q.front();
+				q.pop_front();
+				--pending;
+				if(launch(e))
+					++busy[*h];
+			}
+			if(!busy[*h])
+				busy.erase(*h);
+			if(q.empty())
+			{
+				queued.erase(*h);
+				h = hosts.erase(h);
+			}
+			else
+				++h;
+		}
+	}
+
+	bool Mirror::launch(const Entry& e)
+	{
+		std::unique_ptr<Transfer> t(new Transfer);
+		t->entry = e;
+		t->host = hostOf(e.url);
+		t->menu = urlType(e.url) == TYPE_DIR;
+		if(!safeHost(t->host))
+		{
+			done(*t, false, "bad host name");
+			return false;
+		}
+		std::string path = localPath(root, e.url, t->menu);
+		if(!makeParents(path))
+		{
+			done(*t, false, "could not create directory for " + path);
+			return false;
+		}
+		int reqid;
+		if(t->menu)
+		{
+			t->file.reset(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+			if(!t->file.valid())
+			{
+				done(*t, false, "could not open " + path);
+				return false;
+			}
+			reqid = newRequest();
+			fetch(reqid, e.url, TYPE_DIR);
+		}
+		else
+			reqid = download(e.url, path, 0, FOREGROUND);
+		active[reqid] = std::move(t);
+		return true;
+	}
+
+	void Mirror::receive(Message& m)
+	{
+		auto a = active.find(m.reqid);
+		if(a == active.end())
+			return;
+		Transfer& t = *a->second;
+		if(m.type == Message::DATA)
+		{
+			if(t.file.valid() && write(t.file.get(), m.slice.data(), m.slice.size) != ssize_t(m.slice.size))
+				t.file.close();
+			t.parser.feed(t.page, m.slice.data(), m.slice.size);
+			return;
+		}
+		bytes += m.timing.bytes;
+		bool ok = m.type == Message::FINISHED;
+		std::string error = m.data;
+		if(ok && t.menu)
+		{
+			t.parser.finish(t.page);
+			if(!t.file.valid() || t.file.close() == -1)
+			{
+				ok = false;
+				error = "could not write menu";
+			}
+			for(size_t i = 0; i < t.page.size() && t.entry.depth < depth; ++i)
+			{
+				if(!t.page.hasUrl(i) || !followed(t.page.types[i]))
+					continue;
+				std::string url = normalizeUrl(t.page.url(i));
+				if((anyHost || hostOf(url) == startHost) && seen.insert(url).second)
+					add({url, t.entry.depth + 1}, true);
+			}
+		}
+		done(t, ok, error);
+		if(--busy[t.host] == 0)
+			busy.erase(t.host);
+		active.erase(a);
+	}
+
+	void Mirror::done(const Transfer& t, bool ok, const std::string& error)
+	{
+		if(ok)
+			++(t.menu ? menus : files);
+		else
+		{
+			++failed;
+			std::cerr << t.entry.url << ": " << error << "\n";
+		}
+		fprintf(journal, "%c %s\n", ok ? 'D' : 'F', t.entry.url.c_str());
+		fflush(journal);
+	}
+}
+
+// Keeps up to -j requests in flight and reports progress every second.
+int runMirror(int argc, char** argv)
+{
+	Mirror mirror;
+	mirror.root = "mirror";
+	std::string url;
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if(arg == "--any-host")
+		{
+			mirror.anyHost = true;
+			continue;
+		}
+		if(i+1 == argc)
+		{
+			usage();
+			return 2;
+		}
+		if(arg == "--mirror")
+			url = argv[++i];
+		else if(arg == "-o")
+			mirror.root = argv[++i];
+		else if(arg == "-j")
+			mirror.jobs = atoi(argv[++i]);
+		else if(arg == "--depth")
+			mirror.depth = atoi(argv[++i]);
+		else if(arg == "--per-host")
+			mirror.perHost = std::min(atoi(argv[++i]), MAX_HOST_CONNECTIONS);
+		else
+		{
+			usage();
+			return 2;
+		}
+	}
+	if(url.empty() || mirror.jobs < 1 || mirror.depth < 0 || mirror.perHost < 1)
+	{
+		usage();
+		return 2;
+	}
+	url = normalizeUrl(url);
+	mirror.startHost = hostOf(url);
+	std::string journalPath = mirror.root + "/" + JOURNAL_NAME;
+	if(!makeParents(journalPath))
+	{
+		std::cerr << "Could not create " << mirror.root << "\n";
+		return 2;
+	}
+	bool resumed = mirror.resume();
+	mirror.journal = fopen(journalPath.c_str(), "a");
+	if(!mirror.journal)
+	{
+		std::cerr << "Could not open " << journalPath << "\n";
+		return 2;
+	}
+	if(!resumed && mirror.seen.insert(url).second)
+		mirror.add({url, 0}, true);
+	if(!mirror.pending)
+	{
+		fclose(mirror.journal);
+		return 0;
+	}
+
+	std::thread worker = startWorker();
+	std::vector<Message> messages;
+	int64_t start = steadyMicroseconds(), last = start;
+	size_t lastDocuments = 0, lastBytes = 0;
+	mirror.start();
+	while(mirror.active.size() || mirror.pending)
+	{
+		waitForMessages(PROGRESS_INTERVAL);
+		dataQueue.popAll(messages);
+		for(auto& m : messages)
+			mirror.receive(m);
+		messages.clear();
+		fflush(mirror.journal);
+		mirror.start();
+
+		int64_t now = steadyMicroseconds();
+		if(now - last >= PROGRESS_INTERVAL * 1000)
+		{
+			size_t documents = mirror.menus + mirror.files;
+			double s = (now - last) / 1e6;
+			char buf[160];
+			snprintf(buf, sizeof(buf), "%zu menus, %zu files, %zu failed, %zu queued, %zu active, %.1f pages/s, %.0f KiB/s\n",
+				mirror.menus, mirror.files, mirror.failed, mirror.pending, mirror.active.size(),
+				(documents - lastDocuments) / s, (mirror.bytes - lastBytes) / 1024.0 / s);
+			std::cerr << buf;
+			lastDocuments = documents;
+			lastBytes = mirror.bytes;
+			last = now;
+		}
+	}
+	endWorker();
+	worker.join();
+	fclose(mirror.journal);
+
+	double s = (steadyMicroseconds() - start) / 1e6;
+	char buf[160];
+	snprintf(buf, sizeof(buf), "Mirrored %zu menus and %zu files, %zu failed, %.1f KiB in %.1f s, %.1f pages/s, %.0f KiB/s\n",
+		mirror.menus, mirror.files, mirror.failed, mirror.bytes / 1024.0, s,
+		s > 0 ? (mirror.menus + mirror.files) / s : 0, s > 0 ? mirror.bytes / 1024.0 / s : 0);
+	std::cerr << buf;
+	return mirror.failed ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// ferret --mirror <url> [-o directory] [-j N] [--depth D] [--per-host N] [--any-host]
+// Crawls menus breadth-first from url, D links deep, saving each menu as
+// <directory>/<host>/<selector>/gophermap and each other item under its
+// selector. Only url's host is followed unless --any-host is given, and
+// at most --per-host requests go to one host at a time. The worker never
+// opens more than MAX_HOST_CONNECTIONS to a host, so larger values are
+// clamped to it. Progress is kept in <directory>/.ferret-mirror, so
+// running the same command again carries on where an interrupted mirror
+// stopped.
+int runMirror(int argc, char** argv);
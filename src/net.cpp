@@ -1,6 +1,7 @@
 #include <memory.h>
 #include <sys/socket.h>
 #include <netinet/tcp.h>
+#include <algorithm>
 #include <fcntl.h>
 #include <netdb.h>
 #include <unistd.h>
@@ -8,24 +9,14 @@
 #include <iostream>
 #include "net.h"
 
-Result opensocket(const char* address, const char* port)
+Result opensocket(const addrinfo* address)
 {
-	addrinfo info;
-	memset(&info, 0, sizeof(info));
-	info.ai_family = AF_INET;
-	info.ai_socktype = SOCK_STREAM;
-	addrinfo* res;
-	int e_addr = getaddrinfo(address, port, &info, &res);
-	if(e_addr < 0)
+	if(!address)
 	{
 		return {-1, "Could not open address" };
 	}
-	if(!res)
-	{
-		return {-1, strerror(errno) };
-	}
 
-	int client = socket(AF_INET, SOCK_STREAM, 0);
+	int client = socket(address->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
 	if(client == -1)
 	{
 		return {-1, strerror(errno) };
@@ -33,6 +24,94 @@ Result opensocket(const char* address, const char* port)
 
 	int flags = fcntl(client, F_GETFL);
 	fcntl(client, F_SETFL, flags | O_NONBLOCK);
-	connect(client, res->ai_addr, res->ai_addrlen);
+	if(connect(client, address->ai_addr, address->ai_addrlen) == -1 && errno != EINPROGRESS)
+	{
+		const char* error = strerror(errno);
+		close(client);
+		return {-1, error };
+	}
 	return {client, ""};
 }
+
+Connector::Connector(const addrinfo* list) : next(0), error("Could not open address")
+{
+	std::vector<const addrinfo*> v6, v4;
+	for(auto a = list; a; a = a->ai_next)
+	{
+		if(a->ai_family == AF_INET6)
+			v6.push_back(a);
+		else
+			v4.push_back(a);
+	}
+	for(size_t i = 0; i < std::max(v6.size(), v4.size()); ++i)
+	{
+		if(i < v6.size())
+			addresses.push_back(v6[i]);
+		if(i < v4.size())
+			addresses.push_back(v4[i]);
+	}
+}
+
+// Starts the next connection attempt, skipping addresses that fail
+// immediately. Returns the new socket, or -1 if no addresses are left.
+int Connector::start()
+{
+	while(pending())
+	{
+		Result r = opensocket(addresses[next++]);
+		if(r.result != -1)
+		{
+			attempts.push_back(UniqueFd(r.result));
+			nextAttempt = std::chrono::steady_clock::now() + std::chrono::milliseconds(CONNECT_DELAY);
+			return r.result;
+		}
+		error = r.error;
+	}
+	return -1;
+}
+
+// Checks a socket that became writable. Returns 1 if it connected, 0 if
+// it is still in progress and -1 if the attempt failed.
+int Connector::finish(int fd)
+{
+	int e = 0;
+	socklen_t len = sizeof(e);
+	if(getsockopt(fd, SOL_SOCKET, SO_ERROR, &e, &len) == -1)
+		e = errno;
+	if(e)
+	{
+		error = strerror(e);
+		return -1;
+	}
+	// SO_ERROR is also clear while the connect is still in flight
+	sockaddr_storage peer;
+	socklen_t peerlen = sizeof(peer);
+	if(getpeername(fd, (sockaddr*)&peer, &peerlen) == -1)
+	{
+		if(errno == ENOTCONN)
+			return 0;
+		error = strerror(errno);
+		return -1;
+	}
+	return 1;
+}
+
+void Connector::drop(int fd)
+{
+	auto i = std::find_if(attempts.begin(), attempts.end(), [fd](const UniqueFd& a) { return a.get() == fd; });
+	if(i != attempts.end())
+		attempts.erase(i);
+}
+
+// Hands over the attempt that connected and closes all the others.
+UniqueFd Connector::take(int fd)
+{
+	UniqueFd winner;
+	for(auto& a : attempts)
+	{
+		if(a.get() == fd)
+			winner = std::move(a);
+	}
+	attempts.clear();
+	return winner;
+}
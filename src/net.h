@@ -1,9 +1,39 @@
 #pragma once
 
+#include <chrono>
+#include <vector>
+#include "fd.h"
+
+struct addrinfo;
+
+const int CONNECT_DELAY = 250;
+
 struct Result
 {
 	int result;
 	const char* error;
 };
 
-Result opensocket(const char* address, const char* port);
+Result opensocket(const addrinfo* address);
+
+// Races non-blocking connects to every resolved address, RFC 8305 style:
+// address families are interleaved starting with IPv6, and a new attempt
+// is started every CONNECT_DELAY, or as soon as one fails, until one of
+// them completes.
+struct Connector
+{
+	std::vector<const addrinfo*> addresses;
+	std::vector<UniqueFd> attempts;
+	size_t next;
+	std::chrono::steady_clock::time_point nextAttempt;
+	const char* error;
+
+	Connector(const addrinfo* list);
+
+	int start();
+	int finish(int fd);
+	void drop(int fd);
+	UniqueFd take(int fd);
+	bool pending() const { return next < addresses.size(); }
+	bool failed() const { return !attempts.size() && !pending(); }
+};
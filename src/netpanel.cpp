@@ -0,0 +1,108 @@
+#include "netpanel.h"
+#include <algorithm>
+#include <cstdio>
+
+const size_t MAX_ENTRIES = 200;
+const int ROW_HEIGHT = 20;
+const int URL_WIDTH = 320;
+const int INFO_WIDTH = 150;
+const int PADDING = 8;
+
+NetworkPanel::NetworkPanel(Window* parent)
+{
+	handle = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	gtk_window_set_title(GTK_WINDOW(handle), "Network");
+	gtk_window_set_default_size(GTK_WINDOW(handle), 960, 400);
+	gtk_window_set_transient_for(GTK_WINDOW(handle), GTK_WINDOW(parent->handle));
+	g_signal_connect(handle, "delete-event", G_CALLBACK(gtk_widget_hide_on_delete), 0);
+
+	auto scroll = gtk_scrolled_window_new(0, 0);
+	area = gtk_drawing_area_new();
+	gtk_container_add(GTK_CONTAINER(scroll), area);
+	gtk_container_add(GTK_CONTAINER(handle), scroll);
+	g_signal_connect(area, "draw", G_CALLBACK(_static_draw), this);
+}
+
+void NetworkPanel::add(const std::string& url, const Timing& timing, bool failed)
+{
+	entries.push_back({url, timing, failed});
+	if(entries.size() > MAX_ENTRIES)
+		entries.pop_front();
+	gtk_widget_set_size_request(area, -1, entries.size() * ROW_HEIGHT);
+	gtk_widget_queue_draw(area);
+}
+
+void NetworkPanel::show()
+{
+	gtk_widget_show_all(handle);
+	gtk_window_present(GTK_WINDOW(handle));
+}
+
+void NetworkPanel::draw(cairo_t* cr)
+{
+	int width = gtk_widget_get_allocated_width(area);
+	auto style = gtk_widget_get_style_context(area);
+	gtk_render_background(style, cr, 0, 0, width, gtk_widget_get_allocated_height(area));
+	if(entries.empty())
+		return;
+
+	int64_t first = entries.front().timing.start;
+	int64_t last = first + 1;
+	for(auto& e : entries)
+	{
+		first = std::min(first, e.timing.start);
+		last = std::max(last, e.timing.start + e.timing.end());
+	}
+	double left = URL_WIDTH + PADDING * 2;
+	double scale = std::max(width - left - INFO_WIDTH - PADDING, 1.0) / (last - first);
+
+	GdkRGBA fg;
+	gtk_style_context_get_color(style, gtk_widget_get_state_flags(area), &fg);
+	auto layout = gtk_widget_create_pango_layout(area, 0);
+	pango_layout_set_width(layout, URL_WIDTH * PANGO_SCALE);
+	pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
+	for(size_t i = 0; i < entries.size(); ++i)
+	{
+		const Entry& e = entries[i];
+		const Timing& t = e.timing;
+		double y = i * ROW_HEIGHT;
+
+		// DNS, connect, waiting for the first byte, transfer
+		struct { int64_t from, to; double r, g, b; } stages[] = {
+			{ 0, t.resolved, 0.3, 0.7, 0.3 },
+			{ t.resolved, t.connected, 1.0, 0.6, 0.1 },
+			{ t.connected, t.firstByte, 0.6, 0.6, 0.6 },
+			{ t.firstByte, t.lastByte, 0.2, 0.4, 0.9 },
+		};
+		double x = left + (t.start - first) * scale;
+		for(auto& s : stages)
+		{
+			if(s.from < 0 || s.to < 0)
+				continue;
+			cairo_set_source_rgb(cr, s.r, s.g, s.b);
+			cairo_rectangle(cr, x + s.from * scale, y + 4, std::max((s.to - s.from) * scale, 1.0), ROW_HEIGHT - 8);
+			cairo_fill(cr);
+		}
+
+		if(e.failed)
+			cairo_set_source_rgb(cr, 0.8, 0, 0);
+		else
+			gdk_cairo_set_source_rgba(cr, &fg);
+		pango_layout_set_text(layout, e.url.c_str(), -1);
+		cairo_move_to(cr, PADDING, y + 2);
+		pango_cairo_show_layout(cr, layout);
+
+		char info[64];
+		snprintf(info, sizeof(info), "%.0f ms, %.1f KiB", t.end() / 1000.0, t.bytes / 1024.0);
+		pango_layout_set_text(layout, info, -1);
+		cairo_move_to(cr, width - INFO_WIDTH, y + 2);
+		pango_cairo_show_layout(cr, layout);
+	}
+	g_object_unref(layout);
+}
+
+gboolean NetworkPanel::_static_draw(GtkWidget* w, cairo_t* cr, gpointer d)
+{
+	reinterpret_cast<NetworkPanel*>(d)->draw(cr);
+	return true;
+}
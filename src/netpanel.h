@@ -0,0 +1,34 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include "timing.h"
+#include "ui.h"
+
+// A window listing recent requests as a waterfall. Each row shows one
+// request's DNS, connect, waiting and transfer stages on a time scale
+// shared by all rows, so slow stages and overlapping requests stand out.
+class NetworkPanel : public Widget
+{
+public:
+	struct Entry
+	{
+		std::string url;
+		Timing timing;
+		bool failed;
+	};
+
+	NetworkPanel(Window* parent);
+	~NetworkPanel() {}
+
+	void add(const std::string& url, const Timing& timing, bool failed);
+	void show();
+
+private:
+	std::deque<Entry> entries;
+	GtkWidget* area;
+
+	void draw(cairo_t* cr);
+
+	static gboolean _static_draw(GtkWidget* w, cairo_t* cr, gpointer d);
+};
@@ -0,0 +1,145 @@
+#include "pagebuffer.h"
+#include <string>
+
+namespace
+{
+	struct Icon
+	{
+		int offset;
+		GdkPixbuf* pixbuf;
+	};
+
+	int countValid(const char* text, size_t length)
+	{
+		int count = 0;
+		for(size_t i = 0; i < length; ++i)
+			count += (text[i] & 0xc0) != 0x80;
+		return count;
+	}
+
+	// GTK drops a whole insert over one byte of bad UTF-8, so each byte it
+	// would refuse, NUL included, goes into run as U+FFFD instead. Returns
+	// the characters text becomes; with no run it only counts them.
+	int appendText(std::string* run, const char* text, size_t length)
+	{
+		int count = 0;
+		const gchar* end;
+		while(!g_utf8_validate(text, length, &end))
+		{
+			size_t valid = end - text;
+			if(run)
+			{
+				run->append(text, valid);
+				run->append("\xef\xbf\xbd", 3);
+			}
+			count += countValid(text, valid) + 1;
+			text += valid + 1;
+			length -= valid + 1;
+		}
+		if(run)
+			run->append(text, length);
+		return count + countValid(text, length);
+	}
+
+	int charCount(const char* text, size_t length)
+	{
+		return appendText(0, text, length);
+	}
+}
+
+void appendItems(GtkTextBuffer* buffer, const BufferStyle& style, const Page& page, size_t from, size_t to, std::vector<Link>& links)
+{
+	if(from >= to)
+		return;
+
+	// build the batch as one run, noting where icons go and where links
+	// are, in characters from the start of the run
+	std::string run;
+	std::vector<Icon> icons;
+	size_t firstLink = links.size();
+	int chars = 0;
+	for(size_t i = from; i < to; ++i)
+	{
+		int type = page.types[i];
+		if(type != TYPE_INFO)
+		{
+			if(style.icons[type])
+				icons.push_back({chars, style.icons[type]});
+			run.append("    ", 4);
+			chars += 4;
+		}
+		int count = appendText(&run, page.text(i), page.textLength(i));
+		if(type != TYPE_INFO)
+			links.push_back({type == TYPE_SEARCH ? Link::SEARCH : Link::LINK, chars, chars + count, i});
+		run += '\n';
+		chars += count + 1;
+	}
+
+	GtkTextIter end;
+	gtk_text_buffer_get_end_iter(buffer, &end);
+	int base = gtk_text_iter_get_offset(&end);
+	auto mark = gtk_text_buffer_create_mark(buffer, 0, &end, true);
+	gtk_text_buffer_insert(buffer, &end, run.data(), run.size());
+
+	// each pixbuf takes up one character, shifting everything after it
+	GtkTextIter at;
+	gtk_text_buffer_get_iter_at_mark(buffer, &at, mark);
+	int offset = 0;
+	for(size_t k = 0; k < icons.size(); ++k)
+	{
+		int target = icons[k].offset + k;
+		gtk_text_iter_forward_chars(&at, target - offset);
+		gtk_text_buffer_insert_pixbuf(buffer, &at, icons[k].pixbuf);
+		offset = target + 1;
+	}
+
+	GtkTextIter start, stop;
+	gtk_text_buffer_get_iter_at_mark(buffer, &start, mark);
+	offset = 0;
+	size_t k = 0;
+	for(size_t l = firstLink; l < links.size(); ++l)
+	{
+		Link& link = links[l];
+		for(; k < icons.size() && icons[k].offset < link.start; ++k)
+		{
+			int iconOffset = icons[k].offset + k;
+			gtk_text_iter_forward_chars(&start, iconOffset - offset);
+			stop = start;
+			gtk_text_iter_forward_char(&stop);
+			gtk_text_buffer_apply_tag(buffer, style.icon, &start, &stop);
+			offset = iconOffset;
+		}
+		link.start += k;
+		link.end += k;
+		gtk_text_iter_forward_chars(&start, link.start - offset);
+		stop = start;
+		gtk_text_iter_forward_chars(&stop, link.end - link.start);
+		gtk_text_buffer_apply_tag(buffer, style.link, &start, &stop);
+		offset = link.start;
+		link.start += base;
+		link.end += base;
+	}
+	gtk_text_buffer_delete_mark(buffer, mark);
+}
+
+void itemIter(GtkTextBuffer* buffer, const BufferStyle& style, const Page& page, size_t item, size_t offset, GtkTextIter* iter)
+{
+	int type = page.types[item];
+	int prefix = type == TYPE_INFO ? 0 : (style.icons[type] ? 1 : 0) + 4;
+	gtk_text_buffer_get_iter_at_line_offset(buffer, iter, item, prefix + charCount(page.text(item), offset));
+}
+
+void tagMatches(GtkTextBuffer* buffer, const BufferStyle& style, const Page& page, const Finder& finder, size_t first, size_t last)
+{
+	GtkTextIter start, stop;
+	gtk_text_buffer_get_bounds(buffer, &start, &stop);
+	gtk_text_buffer_remove_tag(buffer, style.match, &start, &stop);
+	gtk_text_buffer_remove_tag(buffer, style.currentMatch, &start, &stop);
+	for(size_t k = finder.firstFrom(first); k < finder.matches.size() && finder.matches[k].item < last; ++k)
+	{
+		auto& m = finder.matches[k];
+		itemIter(buffer, style, page, m.item, m.start, &start);
+		itemIter(buffer, style, page, m.item, m.start + finder.needle.size(), &stop);
+		gtk_text_buffer_apply_tag(buffer, k == finder.current ? style.currentMatch : style.match, &start, &stop);
+	}
+}
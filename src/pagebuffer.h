@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <gtk/gtk.h>
+#include "find.h"
+#include "gopher.h"
+#include "link.h"
+
+// The tags and icons items are drawn with.
+struct BufferStyle
+{
+	GtkTextTag* link;
+	GtkTextTag* icon;
+	GdkPixbuf** icons;
+	GtkTextTag* match;
+	GtkTextTag* currentMatch;
+};
+
+// Appends items [from, to) of a page to the end of a buffer. The batch's
+// text goes in as a single insert; icons and tags are then applied in one
+// forward walk, so the cost per item does not depend on the buffer's size.
+void appendItems(GtkTextBuffer* buffer, const BufferStyle& style, const Page& page, size_t from, size_t to, std::vector<Link>& links);
+
+// Clears the match tags, then tags the matches in items [first, last) of a
+// page, which appendItems must already have added. Callers pass the lines
+// on screen, so the work doesn't grow with the page.
+void tagMatches(GtkTextBuffer* buffer, const BufferStyle& style, const Page& page, const Finder& finder, size_t first, size_t last);
+
+// Points iter at a byte offset into an item's text, as appendItems laid
+// it out.
+void itemIter(GtkTextBuffer* buffer, const BufferStyle& style, const Page& page, size_t item, size_t offset, GtkTextIter* iter);
@@ -0,0 +1,138 @@
+#include "prefetch.h"
+#include "worker.h"
+
+const size_t MAX_WAITING = 64;
+
+bool Prefetcher::known(const std::string& key) const
+{
+	if(cache.index.count(key))
+		return true;
+	for(auto& r : active)
+	{
+		if(r.second.target.key == key)
+			return true;
+	}
+	return false;
+}
+
+// Hovered items are urgent and go to the front of the queue, even if they
+// were already waiting; visible ones wait their turn. The oldest candidates
+// are dropped once MAX_WAITING are queued.
+void Prefetcher::want(const Page& page, size_t item, bool urgent)
+{
+	if(!enabled || item >= page.size() || !page.hasUrl(item))
+		return;
+	int type = page.types[item];
+	if(type != TYPE_DIR && type != TYPE_FILE)
+		return;
+	std::string url = page.url(item);
+	std::string key = normalizeUrl(url);
+	if(known(key))
+		return;
+	for(auto i = waiting.begin(); i != waiting.end(); ++i)
+	{
+		if(i->key == key)
+		{
+			if(!urgent)
+				return;
+			waiting.erase(i);
+			break;
+		}
+	}
+	Candidate c = {key, url, page.hostNames[page.hosts[item]], type};
+	if(urgent)
+		waiting.push_front(c);
+	else
+		waiting.push_back(c);
+	if(waiting.size() > MAX_WAITING)
+	{
+		if(urgent)
+			waiting.pop_back();
+		else
+			waiting.pop_front();
+	}
+}
+
+void Prefetcher::pump()
+{
+	if(!enabled)
+		return;
+	for(auto i = waiting.begin(); i != waiting.end() && active.size() < maxActive;)
+	{
+		if(perHost[i->host] >= maxPerHost)
+		{
+			++i;
+			continue;
+		}
+		int reqid = newRequest();
+		Request& r = active[reqid];
+		r.target = *i;
+		r.page.reset(new Page);
+		r.page->addBlank();
+		++perHost[i->host];
+		fetch(reqid, i->url, i->type, PREFETCH);
+		i = waiting.erase(i);
+	}
+}
+
+void Prefetcher::finish(std::unordered_map<int, Request>::iterator i)
+{
+	if(--perHost[i->second.target.host] == 0)
+		perHost.erase(i->second.target.host);
+	active.erase(i);
+}
+
+// Returns false for messages that are not for a prefetch.
+bool Prefetcher::receive(Message& m)
+{
+	auto i = active.find(m.reqid);
+	if(i == active.end())
+		return false;
+	Request& r = i->second;
+	bool menu = r.target.type == TYPE_DIR;
+	if(m.type == Message::DATA)
+	{
+		if(menu)
+			r.menuParser.feed(*r.page, m.slice.data(), m.slice.size);
+		else
+			r.textParser.feed(*r.page, m.slice.data(), m.slice.size);
+		return true;
+	}
+	if(m.type == Message::FINISHED)
+	{
+		if(menu)
+			r.menuParser.finish(*r.page);
+		else
+			r.textParser.finish(*r.page);
+		cache.put(r.target.key, r.page);
+	}
+	finish(i);
+	pump();
+	return true;
+}
+
+// Hands an in-flight prefetch for key over to the caller, who then gets
+// the rest of its messages under reqid.
+bool Prefetcher::adopt(const std::string& key, int& reqid, Request& request)
+{
+	for(auto i = active.begin(); i != active.end(); ++i)
+	{
+		if(i->second.target.key == key)
+		{
+			reqid = i->first;
+			request = std::move(i->second);
+			finish(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+void Prefetcher::cancel()
+{
+	for(auto& r : active)
+		::cancel(r.first);
+	active.clear();
+	perHost.clear();
+	waiting.clear();
+}
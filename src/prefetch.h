@@ -0,0 +1,53 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "cache.h"
+#include "gopher.h"
+#include "queue.h"
+
+// Fetches directory and text items the user is likely to open next and
+// puts them in the page cache. At most maxActive prefetches run at once,
+// and at most maxPerHost against any one host. They run at PREFETCH
+// priority, so the worker serves the page being viewed first.
+struct Prefetcher
+{
+	struct Candidate
+	{
+		std::string key;
+		std::string url;
+		std::string host;
+		int type;
+	};
+
+	struct Request
+	{
+		Candidate target;
+		std::shared_ptr<Page> page;
+		MenuParser menuParser;
+		TextParser textParser;
+	};
+
+	PageCache& cache;
+	size_t maxActive;
+	size_t maxPerHost;
+	bool enabled;
+	std::deque<Candidate> waiting;
+	std::unordered_map<int, Request> active;
+	std::unordered_map<std::string, size_t> perHost;
+
+	Prefetcher(PageCache& cache, size_t maxActive, size_t maxPerHost)
+		: cache(cache), maxActive(maxActive), maxPerHost(maxPerHost), enabled(false) {}
+
+	void want(const Page& page, size_t item, bool urgent = false);
+	void pump();
+	bool receive(Message& m);
+	bool adopt(const std::string& key, int& reqid, Request& request);
+	void cancel();
+
+private:
+	bool known(const std::string& key) const;
+	void finish(std::unordered_map<int, Request>::iterator i);
+};
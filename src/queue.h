@@ -1,39 +1,85 @@
 #pragma once
 
-#include <mutex>
+#include <atomic>
 #include <string>
+#include <thread>
 #include <vector>
+#include "buffer.h"
+#include "timing.h"
 
 struct Message
 {
 	int reqid;
 	enum Type { DATA, FINISHED, ERROR } type;
 	std::string data;
+	Slice slice;
+	Timing timing;
+
+	Message() : reqid(-1), type(DATA) {}
+	Message(int reqid, Type type, std::string data) : reqid(reqid), type(type), data(std::move(data)) {}
+	Message(int reqid, Slice slice) : reqid(reqid), type(DATA), slice(std::move(slice)) {}
+	Message(Message&&) = default;
+	Message& operator=(Message&&) = default;
+	Message(const Message&) = delete;
+	Message& operator=(const Message&) = delete;
 };
 
+// Bounded single-producer/single-consumer ring buffer. Only the worker
+// thread may push and only the UI thread may pop.
 struct MessageQueue
 {
-	std::vector<Message> queue;
-	std::mutex queueMtx;
+	static const size_t CAPACITY = 1024;
+
+	std::vector<Message> slots;
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+
+	MessageQueue() : slots(CAPACITY), head(0), tail(0) {}
+
+	bool tryPush(Message&& m)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if(t - head.load(std::memory_order_acquire) == CAPACITY)
+			return false;
+		slots[t % CAPACITY] = std::move(m);
+		tail.store(t+1, std::memory_order_release);
+		return true;
+	}
 
-	Message pop()
+	void push(Message&& m)
 	{
-		std::unique_lock<std::mutex> lock(queueMtx);
-		Message m = queue[0];
-		queue.erase(queue.begin());
-		return m;
+		// the consumer is a whole ring behind, wait for it to catch up
+		while(!tryPush(std::move(m)))
+			std::this_thread::yield();
 	}
 
-	void push(const Message& m)
+	bool pop(Message& m)
 	{
-		std::unique_lock<std::mutex> lock(queueMtx);
-		queue.push_back(m);
+		size_t h = head.load(std::memory_order_relaxed);
+		if(h == tail.load(std::memory_order_acquire))
+			return false;
+		m = std::move(slots[h % CAPACITY]);
+		head.store(h+1, std::memory_order_release);
+		return true;
 	}
 
-	size_t size() const { return queue.size(); }
+	size_t popAll(std::vector<Message>& out)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t t = tail.load(std::memory_order_acquire);
+		for(size_t i = h; i != t; ++i)
+			out.push_back(std::move(slots[i % CAPACITY]));
+		head.store(t, std::memory_order_release);
+		return t - h;
+	}
+
+	size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
 };
 
 extern MessageQueue dataQueue;
+// queueData() writes to queueEvent when queueSignalled is clear. The
+// consumer clears it before popping.
+extern int queueEvent;
+extern std::atomic<bool> queueSignalled;
 
-void queueData(const Message& m);
-
+void queueData(Message&& m);
@@ -0,0 +1,155 @@
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <memory.h>
+#include <sys/socket.h>
+#include "resolver.h"
+
+typedef std::chrono::steady_clock Clock;
+
+const int RESOLVER_THREADS = 4;
+const size_t MAX_CACHE_ENTRIES = 256;
+const std::chrono::seconds CACHE_TTL(300);
+const std::chrono::seconds NEGATIVE_TTL(30);
+
+struct CacheEntry
+{
+	AddressList addresses;
+	std::string error;
+	Clock::time_point expires;
+};
+
+struct Waiter
+{
+	std::shared_ptr<Lookup> lookup;
+	void (*notify)();
+};
+
+std::mutex resolverMtx;
+std::condition_variable resolverCv;
+std::deque<std::string> pendingLookups;
+std::unordered_map<std::string, std::vector<Waiter>> waiters;
+std::unordered_map<std::string, CacheEntry> resolverCache;
+std::vector<std::thread> resolvers;
+bool resolverRunning = false;
+
+void answer(Lookup& lookup, const CacheEntry& entry)
+{
+	lookup.addresses = entry.addresses;
+	lookup.error = entry.error;
+	lookup.done = true;
+}
+
+void store(const std::string& key, const CacheEntry& entry)
+{
+	if(resolverCache.size() >= MAX_CACHE_ENTRIES)
+	{
+		auto now = Clock::now();
+		for(auto i = resolverCache.begin(); i != resolverCache.end();)
+		{
+			if(i->second.expires <= now)
+				i = resolverCache.erase(i);
+			else
+				++i;
+		}
+		if(resolverCache.size() >= MAX_CACHE_ENTRIES)
+			resolverCache.clear();
+	}
+	resolverCache[key] = entry;
+}
+
+void runResolver()
+{
+	std::unique_lock<std::mutex> lock(resolverMtx);
+	while(true)
+	{
+		resolverCv.wait(lock, [](){ return !resolverRunning || pendingLookups.size(); });
+		if(!resolverRunning)
+			return;
+		std::string key = pendingLookups.front();
+		pendingLookups.pop_front();
+		auto& first = waiters[key][0].lookup;
+		std::string host = first->host;
+		std::string port = first->port;
+		lock.unlock();
+
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_ADDRCONFIG;
+		addrinfo* res = 0;
+		CacheEntry entry;
+		int e = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+		if(e != 0 || !res)
+		{
+			entry.error = e ? gai_strerror(e) : "Could not open address";
+			entry.expires = Clock::now() + NEGATIVE_TTL;
+		}
+		else
+		{
+			entry.addresses.reset(res, freeaddrinfo);
+			entry.expires = Clock::now() + CACHE_TTL;
+		}
+
+		lock.lock();
+		store(key, entry);
+		std::vector<Waiter> done;
+		done.swap(waiters[key]);
+		waiters.erase(key);
+		for(auto& w : done)
+		{
+			answer(*w.lookup, entry);
+			w.notify();
+		}
+	}
+}
+
+bool resolve(const std::shared_ptr<Lookup>& lookup, void (*notify)())
+{
+	std::string key = lookup->host + ":" + lookup->port;
+	std::unique_lock<std::mutex> lock(resolverMtx);
+	auto cached = resolverCache.find(key);
+	if(cached != resolverCache.end())
+	{
+		if(cached->second.expires > Clock::now())
+		{
+			answer(*lookup, cached->second);
+			return true;
+		}
+		resolverCache.erase(cached);
+	}
+
+	if(!resolverRunning)
+	{
+		resolverRunning = true;
+		for(int i = 0; i < RESOLVER_THREADS; ++i)
+			resolvers.push_back(std::thread(runResolver));
+	}
+	auto& w = waiters[key];
+	if(!w.size())
+	{
+		pendingLookups.push_back(key);
+		resolverCv.notify_one();
+	}
+	w.push_back({lookup, notify});
+	return false;
+}
+
+void endResolver()
+{
+	{
+		std::unique_lock<std::mutex> lock(resolverMtx);
+		resolverRunning = false;
+		pendingLookups.clear();
+		waiters.clear();
+	}
+	resolverCv.notify_all();
+	for(auto& t : resolvers)
+		t.join();
+	resolvers.clear();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <netdb.h>
+
+typedef std::shared_ptr<addrinfo> AddressList;
+
+struct Lookup
+{
+	std::string host;
+	std::string port;
+	AddressList addresses;
+	std::string error;
+	std::atomic<bool> done;
+
+	Lookup(const std::string& host, const std::string& port) : host(host), port(port), done(false) {}
+};
+
+// Returns true if the lookup was answered from the cache. Otherwise it is
+// resolved on a background thread, and notify() is called when it is done.
+bool resolve(const std::shared_ptr<Lookup>& lookup, void (*notify)());
+void endResolver();
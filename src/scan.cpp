@@ -0,0 +1,72 @@
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#include "scan.h"
+
+namespace
+{
+	void scanPortable(const char* data, size_t size, char a, char b, uint32_t base, std::vector<uint32_t>& offsets)
+	{
+		for(size_t i = 0; i < size; ++i)
+		{
+			if(data[i] == a || data[i] == b)
+				offsets.push_back(base + i);
+		}
+	}
+
+#ifdef __SSE2__
+	void scanSse2(const char* data, size_t size, char a, char b, uint32_t base, std::vector<uint32_t>& offsets)
+	{
+		const __m128i va = _mm_set1_epi8(a);
+		const __m128i vb = _mm_set1_epi8(b);
+		size_t i = 0;
+		for(; i + 16 <= size; i += 16)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)));
+			for(; mask; mask &= mask - 1)
+				offsets.push_back(base + i + __builtin_ctz(mask));
+		}
+		scanPortable(data + i, size - i, a, b, base + i, offsets);
+	}
+
+	__attribute__((target("avx2")))
+	void scanAvx2(const char* data, size_t size, char a, char b, uint32_t base, std::vector<uint32_t>& offsets)
+	{
+		const __m256i va = _mm256_set1_epi8(a);
+		const __m256i vb = _mm256_set1_epi8(b);
+		size_t i = 0;
+		for(; i + 32 <= size; i += 32)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+			unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(x, vb)));
+			for(; mask; mask &= mask - 1)
+				offsets.push_back(base + i + __builtin_ctz(mask));
+		}
+		scanSse2(data + i, size - i, a, b, base + i, offsets);
+	}
+#endif
+}
+
+void scanBytes(const char* data, size_t size, char a, char b, uint32_t base, std::vector<uint32_t>& offsets)
+{
+#ifdef __SSE2__
+	static const bool avx2 = cpuHasAvx2();
+	if(avx2)
+		scanAvx2(data, size, a, b, base, offsets);
+	else
+		scanSse2(data, size, a, b, base, offsets);
+#else
+	scanPortable(data, size, a, b, base, offsets);
+#endif
+}
+
+bool cpuHasAvx2()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
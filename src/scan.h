@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Appends base + i to offsets for every i in [0, size) where data[i] is a
+// or b, in order. In builds with SSE2, blocks of 32 bytes (AVX2) or 16
+// (SSE2) are compared at once and the hits read off the movemask bits, so
+// the cost is one pass plus a push per hit, however short the lines are.
+// Other builds check a byte at a time.
+void scanBytes(const char* data, size_t size, char a, char b, uint32_t base, std::vector<uint32_t>& offsets);
+
+// Whether the CPU has AVX2, for kernels that pick their width at run time.
+bool cpuHasAvx2();
@@ -1,3 +1,4 @@
+#include <cstring>
 #include "str.h"
 
 std::string lstrip(std::string& s)
@@ -37,18 +38,23 @@ void slice(std::string& str, size_t start, size_t end)
 
 void splitLines(const std::string& str, std::vector<std::string>& lines)
 {
-	size_t i = 0;
-	while(i < str.size())
+	splitLines(str.data(), str.size(), lines);
+}
+
+void splitLines(const char* str, size_t size, std::vector<std::string>& lines)
+{
+	const char* end = str + size;
+	while(str < end)
 	{
-		size_t l = str.find("\n", i);
-		if(l != std::string::npos)
+		auto l = static_cast<const char*>(memchr(str, '\n', end - str));
+		if(l)
 		{
-			lines.push_back(str.substr(i, l-i));
-			i = l+1;
+			lines.push_back(std::string(str, l));
+			str = l+1;
 		}
 		else
 		{
-			lines.push_back(str.substr(i));
+			lines.push_back(std::string(str, end));
 			break;
 		}
 	}
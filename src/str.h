@@ -14,3 +14,5 @@ std::string lstrip(std::string& s);
 std::string strip(std::string& s);
 
 void splitLines(const std::string& str, std::vector<std::string>& lines);
+
+void splitLines(const char* str, size_t size, std::vector<std::string>& lines);
@@ -0,0 +1,57 @@
+#include "timing.h"
+#include <chrono>
+#include <cstdio>
+
+int64_t Timing::end() const
+{
+	int64_t stages[] = { lastByte, firstByte, sent, connected, resolved };
+	for(int64_t s : stages)
+	{
+		if(s >= 0)
+			return s;
+	}
+	return 0;
+}
+
+// Bytes per second over the transfer, from first byte to last.
+double Timing::throughput() const
+{
+	if(firstByte < 0 || lastByte <= firstByte)
+		return 0;
+	return bytes * 1e6 / (lastByte - firstByte);
+}
+
+int64_t steadyMicroseconds()
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+namespace
+{
+	void stage(std::string& out, const char* name, int64_t from, int64_t to)
+	{
+		if(from < 0 || to < 0)
+			return;
+		char buf[64];
+		snprintf(buf, sizeof(buf), "%s%s %.1f ms", out.back() == ':' ? " " : ", ", name, (to - from) / 1000.0);
+		out += buf;
+	}
+}
+
+std::string describe(const Timing& t)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%.1f KiB in %.1f ms:", t.bytes / 1024.0, t.end() / 1000.0);
+	std::string out = buf;
+	stage(out, "DNS", 0, t.resolved);
+	stage(out, "connect", t.resolved, t.connected);
+	stage(out, "first byte", t.sent, t.firstByte);
+	stage(out, "transfer", t.firstByte, t.lastByte);
+	if(t.throughput() > 0)
+	{
+		snprintf(buf, sizeof(buf), ", %.0f KiB/s", t.throughput() / 1024);
+		out += buf;
+	}
+	return out;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// When each stage of a request was reached, in microseconds after start,
+// or -1 if it never was. start is on the steady clock.
+struct Timing
+{
+	int64_t start;
+	int64_t resolved;
+	int64_t connected;
+	int64_t sent;
+	int64_t firstByte;
+	int64_t lastByte;
+	size_t bytes;
+
+	Timing() : start(0), resolved(-1), connected(-1), sent(-1), firstByte(-1), lastByte(-1), bytes(0) {}
+
+	int64_t end() const;
+	double throughput() const;
+};
+
+int64_t steadyMicroseconds();
+
+// e.g. "12 KiB in 85 ms: DNS 3 ms, connect 20 ms, first byte 41 ms, transfer 21 ms, 560 KiB/s"
+std::string describe(const Timing& t);
@@ -58,6 +58,8 @@ public:
 		for(auto w : widgets)
 			delete w;
 	}
+
+	void setVisible(bool v) { gtk_widget_set_visible(handle, v); }
 };
 
 class Window : public Widget
@@ -111,6 +113,29 @@ public:
 	}
 };
 
+class CheckButton : public Widget
+{
+private:
+	std::function<void()> _toggle = [](){};
+
+	static void _static_toggle(GtkWidget* b, void* data)
+	{
+		reinterpret_cast<CheckButton*>(data)->_toggle();
+	}
+
+public:
+	CheckButton(const char* text) { handle = gtk_check_button_new_with_label(text); }
+	~CheckButton() {}
+
+	bool active() { return gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(handle)); }
+
+	template <class F> void onToggle(const F& f)
+	{
+		_toggle = f;
+		g_signal_connect(handle, "toggled", G_CALLBACK(_static_toggle), this);
+	}
+};
+
 class Box : public Widget
 {
 public:
@@ -151,6 +176,8 @@ public:
 		handle = gtk_label_new(text);
 	}
 	~Label() {}
+
+	void setText(const std::string& text) { gtk_label_set_text(GTK_LABEL(handle), text.c_str()); }
 };
 
 class TextView : public Widget
@@ -205,6 +232,26 @@ public:
 	}
 };
 
+class StatusBar : public Widget
+{
+public:
+	StatusBar()
+	{
+		handle = gtk_statusbar_new();
+	}
+	~StatusBar() {}
+
+	// Each context holds its own message; the most recently set one shows.
+	void setText(const char* context, const std::string& text)
+	{
+		auto bar = GTK_STATUSBAR(handle);
+		guint id = gtk_statusbar_get_context_id(bar, context);
+		gtk_statusbar_remove_all(bar, id);
+		if(text.size())
+			gtk_statusbar_push(bar, id, text.c_str());
+	}
+};
+
 class ScrolledWindow : public Widget
 {
 public:
@@ -225,12 +272,18 @@ class Edit : public Widget
 {
 private:
 	std::function<void()> _activate = [](){};
+	std::function<void()> _change = [](){};
 
 	static void _static_activate(GtkWidget* b, void* data)
 	{
 		reinterpret_cast<Edit*>(data)->_activate();
 	}
 
+	static void _static_change(GtkWidget* b, void* data)
+	{
+		reinterpret_cast<Edit*>(data)->_change();
+	}
+
 public:
 	Edit()
 	{
@@ -244,6 +297,12 @@ public:
 		g_signal_connect(handle, "activate", G_CALLBACK(_static_activate), this);
 	}
 
+	template <class F> void onChange(const F& f)
+	{
+		_change = f;
+		g_signal_connect(handle, "changed", G_CALLBACK(_static_change), this);
+	}
+
 	void setText(const std::string& text) { gtk_entry_set_text(GTK_ENTRY(handle), text.c_str()); }
 
 	const char* text() { return gtk_entry_get_text(GTK_ENTRY(handle)); }
@@ -266,6 +325,10 @@ public:
 	{
 		handle = gtk_menu_item_new_with_label(text);
 	}
+	explicit MenuItem(GtkWidget* item)
+	{
+		handle = item;
+	}
 	~MenuItem() {}
 
 	void addMenu(Menu* menu);
@@ -277,6 +340,20 @@ public:
 	}
 };
 
+class CheckMenuItem : public MenuItem
+{
+public:
+	CheckMenuItem(const char* text, bool active = false) : MenuItem(gtk_check_menu_item_new_with_label(text))
+	{
+		setActive(active);
+	}
+	~CheckMenuItem() {}
+
+	bool active() { return gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(handle)); }
+
+	void setActive(bool a) { gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(handle), a); }
+};
+
 class Menu : public Widget
 {
 public:
@@ -1,189 +1,663 @@
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
+#include <cerrno>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include "buffer.h"
+#include "fd.h"
 #include "net.h"
 #include "queue.h"
+#include "resolver.h"
 #include "worker.h"
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 const int TIMEOUT_LENGTH = 10;
-char* downloadBuffer = new char[DL_BUFFER_SIZE];
+const int MAX_EVENTS = 256;
+const int PIPE_SIZE = 0x100000;
+const size_t MAX_CONNECTIONS = 32;
+// how much a prefetch or background transfer may read per pass, with and
+// without a foreground request in progress
+const size_t SLICE = 0x40000;
+const size_t YIELD_SLICE = 0x10000;
 std::mutex mtx;
-bool running = true;
+std::atomic<bool> running(true);
+int pollfd = epoll_create1(EPOLL_CLOEXEC);
+int wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+std::atomic<int> lastRequest(0);
+std::atomic<bool> spliceDownloads(true);
+std::atomic<size_t> backgroundRate(0);
 
+// Owns its socket, file and pipe, so destroying it closes them all.
 struct Downloader
 {
-	int socket;
+	UniqueFd socket;
 	int reqid;
 	std::string remote_path;
+	std::string host;
+	std::string port;
 	std::string local_path;
 	std::string tmp_path;
 	std::string error;
-	std::unique_ptr<std::ostream> file;
+	UniqueFd file;
+	UniqueFd pipe[2];
+	size_t size;
+	size_t pipeSize;
+	std::shared_ptr<Lookup> lookup;
+	std::unique_ptr<Connector> connector;
+	BufferRef buffer;
+	size_t used;
 	time_t start_time;
-	enum State { START, CONNECTING, DOWNLOADING, FINISHED, FAILED, } state;
+	Timing timing;
+	bool cancelled;
+	bool readable;
+	Priority priority;
+	enum State { START, RESOLVING, CONNECTING, DOWNLOADING, FINISHED, FAILED, } state;
 	enum Type { SAVE, QUEUE_DATA, } type;
 
+	Downloader(int reqid, const std::string& remote_path, Type type, Priority priority);
+	~Downloader();
+
+	void parseRemote();
 	void startDownload();
-	void update(fd_set* r, fd_set* w);
+	void openConnection();
+	void connectNext();
+	void closeAttempts();
+	void update(int fd, uint32_t events);
+	size_t receive(size_t budget);
+	size_t spliceReceive(size_t budget);
+	bool store(const char* data, size_t length);
+	void closeFile();
+	void watch(int fd, int op, uint32_t events);
+	void mark(int64_t& stage) { stage = steadyMicroseconds() - timing.start; }
+	void received(size_t bytes);
 };
-std::vector<Downloader*> downloaders;
 
-void Downloader::startDownload()
+// Refills at backgroundRate bytes per second, holding at most one
+// second's worth. A rate of 0 means no limit.
+struct TokenBucket
+{
+	double tokens;
+	std::chrono::steady_clock::time_point last;
+
+	TokenBucket() : tokens(0), last(std::chrono::steady_clock::now()) {}
+
+	void refill()
+	{
+		auto now = std::chrono::steady_clock::now();
+		double rate = backgroundRate;
+		tokens = std::min(tokens + std::chrono::duration<double>(now - last).count() * rate, rate);
+		last = now;
+	}
+
+	size_t available() const { return backgroundRate ? size_t(std::max(tokens, 0.0)) : SIZE_MAX; }
+
+	void take(size_t n)
+	{
+		if(backgroundRate)
+			tokens -= n;
+	}
+
+	// milliseconds until a slice's worth is available
+	int wait() const
+	{
+		if(!backgroundRate)
+			return 0;
+		double rate = backgroundRate;
+		double need = std::min(rate, double(YIELD_SLICE)) - tokens;
+		return need > 0 ? int(need * 1000 / rate) + 1 : 0;
+	}
+};
+
+// owned by the worker thread
+std::vector<std::unique_ptr<Downloader>> downloaders;
+std::vector<std::unique_ptr<Downloader>> waiting;
+std::unordered_map<int, Downloader*> sockets;
+std::unordered_map<std::string, int> hostConnections;
+TokenBucket bucket;
+
+// handed over from fetch()/download()/cancel()/prioritize(), guarded by mtx
+std::vector<std::unique_ptr<Downloader>> incoming;
+std::vector<int> cancelled;
+// set while cancelled is not empty, so a long read can stop early
+std::atomic<bool> cancelPending(false);
+std::vector<std::pair<int, Priority>> reprioritized;
+
+void wakeWorker()
+{
+	uint64_t one = 1;
+	if(write(wakefd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+		std::cerr << "Failed to wake worker: " << strerror(errno) << "\n";
+}
+
+Downloader::Downloader(int reqid, const std::string& remote_path, Type type, Priority priority) :
+	reqid(reqid), remote_path(remote_path), size(0), pipeSize(0), used(0), start_time(0),
+	cancelled(false), readable(false), priority(priority), state(START), type(type)
+{
+	parseRemote();
+}
+
+// An unfinished download leaves no partial file behind.
+Downloader::~Downloader()
+{
+	closeAttempts();
+	if(socket.valid())
+		sockets.erase(socket.get());
+	if(type == SAVE && tmp_path.size() && state != FINISHED)
+		unlink(tmp_path.c_str());
+}
+
+void Downloader::watch(int fd, int op, uint32_t events)
+{
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events | EPOLLET;
+	ev.data.fd = fd;
+	if(epoll_ctl(pollfd, op, fd, &ev) == -1)
+	{
+		error = strerror(errno);
+		state = FAILED;
+	}
+}
+
+void Downloader::parseRemote()
 {
-	start_time = time(0);
 	std::string remote = remote_path;
 	if(remote.find("gopher://")==0) remote = remote.substr(9);
+	host = remote.substr(0, remote.find("/"));
+	host = host.substr(0, host.find(":"));
+	port = "70";
+	if(remote.find(":") != std::string::npos)
+	{
+		port = remote.substr(remote.find(":")+1);
+		port = port.substr(0, port.find("/"));
+	}
+}
+
+void Downloader::startDownload()
+{
+	start_time = time(0);
+	timing.start = steadyMicroseconds();
 	if(type == SAVE)
 	{
 		tmp_path = local_path+".part";
-		std::cout << "Downloading " << remote_path << " to " << local_path << "\n";
-
-		file.reset(new std::ofstream(tmp_path.c_str(), std::ios::binary));
-		if(!file->good())
+		file.reset(open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+		if(!file.valid())
 		{
 			state = FAILED;
 			error = "could not open file for writing";
 			return;
 		}
+		// only a hint, so a file system that cannot preallocate is no error
+		if(size)
+			fallocate(file.get(), FALLOC_FL_KEEP_SIZE, 0, size);
+		// the pipe carries data from the socket to the file without it
+		// passing through user space
+		int p[2];
+		if(spliceDownloads && pipe2(p, O_CLOEXEC | O_NONBLOCK) == 0)
+		{
+			pipe[0].reset(p[0]);
+			pipe[1].reset(p[1]);
+			int s = fcntl(p[1], F_SETPIPE_SZ, PIPE_SIZE);
+			pipeSize = s > 0 ? s : 0x10000;
+		}
 	}
-	std::string host = remote.substr(0, remote.find("/"));
-	host = host.substr(0, host.find(":"));
-	std::string port = "70";
-	if(remote.find(":") != std::string::npos)
-	{
-		port = remote.substr(remote.find(":")+1);
-		port = port.substr(0, port.find("/"));
-	}
+	lookup = std::make_shared<Lookup>(host, port);
+	state = RESOLVING;
+	if(resolve(lookup, wakeWorker))
+		openConnection();
+}
 
-	Result r = opensocket(host.c_str(), port.c_str());
-	if(r.result == -1)
+void Downloader::openConnection()
+{
+	if(lookup->error.size())
 	{
-		error = r.error;
+		error = lookup->error;
 		state = FAILED;
 		return;
 	}
-	socket = r.result;
-
+	mark(timing.resolved);
+	connector.reset(new Connector(lookup->addresses.get()));
 	state = CONNECTING;
+	connectNext();
 }
 
-void Downloader::update(fd_set* rd, fd_set* wr)
+void Downloader::connectNext()
 {
-	if(state == START)
+	int fd = connector->start();
+	if(fd == -1)
 	{
-		startDownload();
+		if(connector->failed())
+		{
+			error = connector->error;
+			state = FAILED;
+		}
 		return;
 	}
-	else if(state == CONNECTING)
+	sockets[fd] = this;
+	watch(fd, EPOLL_CTL_ADD, EPOLLOUT);
+}
+
+void Downloader::closeAttempts()
+{
+	if(!connector)
+		return;
+	for(auto& a : connector->attempts)
+		sockets.erase(a.get());
+	connector.reset();
+}
+
+void Downloader::update(int fd, uint32_t events)
+{
+	if(state == CONNECTING)
 	{
-		if(FD_ISSET(socket, wr))
+		if(!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+			return;
+		int c = connector->finish(fd);
+		if(c == 0)
+			return;
+		if(c == -1)
 		{
-			std::string remote = remote_path;
-			if(remote.find("gopher://")==0) remote = remote.substr(9);
-			std::string file = remote.substr(remote.find("/")+1);
-			auto s = file.find("/");
-			if(s != std::string::npos)
-			{
-				file = file.substr(s);
-			}
-			else
-				file = "";
-			int e = send(socket, (file+"\r\n").c_str(), file.size()+2, 0);
-			if(e == -1)
+			sockets.erase(fd);
+			connector->drop(fd);
+			if(connector->failed())
 			{
-				error = strerror(errno);
+				error = connector->error;
 				state = FAILED;
 			}
-			else
-				state = DOWNLOADING;
+			// a failed attempt hands over to the next address at once
+			// rather than after the rest of CONNECT_DELAY
+			else if(connector->pending())
+				connectNext();
 			return;
 		}
+		for(auto& a : connector->attempts)
+		{
+			if(a.get() != fd)
+				sockets.erase(a.get());
+		}
+		socket = connector->take(fd);
+		connector.reset();
+		lookup.reset();
+		mark(timing.connected);
+
+		std::string remote = remote_path;
+		if(remote.find("gopher://")==0) remote = remote.substr(9);
+		std::string file = remote.substr(remote.find("/")+1);
+		auto s = file.find("/");
+		if(s != std::string::npos)
+		{
+			file = file.substr(s);
+		}
 		else
+			file = "";
+		int e = send(socket.get(), (file+"\r\n").c_str(), file.size()+2, 0);
+		if(e == -1)
+		{
+			error = strerror(errno);
+			state = FAILED;
+			return;
+		}
+		mark(timing.sent);
+		state = DOWNLOADING;
+		watch(socket.get(), EPOLL_CTL_MOD, EPOLLIN);
+	}
+	// the scheduler reads it when its turn comes
+	if(state == DOWNLOADING && (events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+		readable = true;
+}
+
+// Both receive paths read until the socket runs dry, budget bytes have
+// been read or a cancel comes in. In the last two cases the socket is
+// still readable, and since it is edge-triggered, readable stays set so
+// the next pass carries on.
+size_t Downloader::spliceReceive(size_t budget)
+{
+	size_t total = 0;
+	while(total < budget && !cancelPending)
+	{
+		ssize_t n = splice(socket.get(), 0, pipe[1].get(), 0, std::min(pipeSize, budget - total), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if(n == -1)
+		{
+			if(errno == EINTR)
+				continue;
+			if(errno == EAGAIN)
+			{
+				readable = false;
+				return total;
+			}
+			if(errno == EINVAL || errno == ENOSYS)
+			{
+				// not supported for this socket or file: fall back to
+				// copying through a buffer
+				pipe[0].close();
+				pipe[1].close();
+				return total + receive(budget - total);
+			}
+			error = strerror(errno);
+			state = FAILED;
+			return total;
+		}
+		if(n == 0)
+		{
+			mark(timing.lastByte);
+			state = FINISHED;
+			return total;
+		}
+		received(n);
+		total += n;
+		while(n > 0)
 		{
-			time_t now = time(0);
-			if(now - start_time > TIMEOUT_LENGTH)
+			ssize_t w = splice(pipe[0].get(), 0, file.get(), 0, n, SPLICE_F_MOVE);
+			if(w == -1 && errno == EINTR)
+				continue;
+			if(w <= 0)
 			{
+				error = w == -1 ? strerror(errno) : "could not write to file";
 				state = FAILED;
-				error = "Timeout";
+				return total;
 			}
+			n -= w;
 		}
 	}
-	else if(FD_ISSET(socket, rd))
+	return total;
+}
+
+void Downloader::received(size_t bytes)
+{
+	if(timing.firstByte < 0)
+		mark(timing.firstByte);
+	timing.bytes += bytes;
+}
+
+bool Downloader::store(const char* data, size_t length)
+{
+	while(length)
 	{
-		int r = recv(socket, downloadBuffer, DL_BUFFER_SIZE, 0);
-		if(r == -1)
+		ssize_t w = write(file.get(), data, length);
+		if(w == -1 && errno == EINTR)
+			continue;
+		if(w <= 0)
 		{
-			error = strerror(errno);
+			error = w == -1 ? strerror(errno) : "could not write to file";
 			state = FAILED;
+			return false;
+		}
+		data += w;
+		length -= w;
+	}
+	return true;
+}
+
+void Downloader::closeFile()
+{
+	pipe[0].close();
+	pipe[1].close();
+	if(file.close() == -1 && state == FINISHED)
+	{
+		error = strerror(errno);
+		state = FAILED;
+	}
+}
+
+size_t Downloader::receive(size_t budget)
+{
+	size_t total = 0;
+	while(total < budget && !cancelPending)
+	{
+		if(!buffer || used == BUFFER_SIZE)
+		{
+			buffer = allocBuffer();
+			used = 0;
+		}
+		int r = recv(socket.get(), buffer.data() + used, std::min(BUFFER_SIZE - used, budget - total), 0);
+		if(r == -1)
+		{
+			if(errno == EINTR)
+				continue;
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
+				readable = false;
+			else
+			{
+				error = strerror(errno);
+				state = FAILED;
+			}
+			return total;
 		}
 		else if(r == 0)
 		{
+			mark(timing.lastByte);
 			state = FINISHED;
+			return total;
 		}
 		else
 		{
+			received(r);
+			total += r;
 			if(type == SAVE)
-				file->write(downloadBuffer, r);
+			{
+				if(!store(buffer.data() + used, r))
+					return total;
+			}
 			else
-				queueData({reqid, Message::DATA, std::string(downloadBuffer, r)});
+				queueData({reqid, Slice(buffer, used, r)});
+			used += r;
 		}
 	}
+	return total;
 }
 
-void pollDownloaders()
+int pollTimeout()
 {
-	std::unique_lock<std::mutex> lock(mtx);
-	if(!downloaders.size())
-		return;
-	fd_set r;
-	fd_set w;
-	FD_ZERO(&r);
-	FD_ZERO(&w);
-	int max = 0;
+	int timeout = -1;
+	auto now = std::chrono::steady_clock::now();
 	for(auto& d : downloaders)
 	{
-		if(d->socket != -1)
+		// failed on admission, still to be reaped
+		if(d->state == Downloader::FINISHED || d->state == Downloader::FAILED)
+			return 0;
+		// left over from a pass that ran out of budget
+		if(d->state == Downloader::DOWNLOADING && d->readable)
 		{
-			FD_SET(d->socket, &r);
-			FD_SET(d->socket, &w);
-			if(max < d->socket)
-				max = d->socket;
+			int wait = d->priority == BACKGROUND ? bucket.wait() : 0;
+			if(timeout == -1 || wait < timeout)
+				timeout = wait;
+		}
+		if(d->state == Downloader::RESOLVING || d->state == Downloader::CONNECTING)
+			timeout = timeout == -1 ? 1000 : std::min(timeout, 1000);
+		if(d->state == Downloader::CONNECTING && d->connector && d->connector->pending())
+		{
+			auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(d->connector->nextAttempt - now).count();
+			if(timeout == -1 || wait < timeout)
+				timeout = wait > 0 ? wait : 0;
 		}
 	}
-	timeval tv;
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
-	select(max+1, &r, &w, 0, &tv);
+	return timeout;
+}
+
+bool byPriority(const std::unique_ptr<Downloader>& a, const std::unique_ptr<Downloader>& b)
+{
+	return a->priority < b->priority;
+}
+
+// Starts waiting downloaders in priority order. Each host gets at most
+// MAX_HOST_CONNECTIONS, the last of which only a foreground request may
+// take, and lower classes stop at MAX_CONNECTIONS in all.
+void admit()
+{
+	for(auto i = waiting.begin(); i != waiting.end();)
+	{
+		Downloader* d = i->get();
+		bool foreground = d->priority == FOREGROUND;
+		auto h = hostConnections.find(d->host);
+		int count = h == hostConnections.end() ? 0 : h->second;
+		if(count >= MAX_HOST_CONNECTIONS - !foreground || (!foreground && downloaders.size() >= MAX_CONNECTIONS))
+		{
+			++i;
+			continue;
+		}
+		++hostConnections[d->host];
+		downloaders.push_back(std::move(*i));
+		i = waiting.erase(i);
+		d->startDownload();
+	}
+}
+
+// Reads from every readable downloader, foreground first. Foreground reads
+// are unbounded; the others get a slice per pass, a smaller one while a
+// foreground request is running, and background reads are also held to
+// the token bucket.
+void service()
+{
+	bool foreground = false;
+	for(auto& d : downloaders)
+		foreground = foreground || d->priority == FOREGROUND;
+	bucket.refill();
+	for(int p = FOREGROUND; p <= BACKGROUND; ++p)
+	{
+		for(auto& d : downloaders)
+		{
+			if(d->priority != p || d->state != Downloader::DOWNLOADING || !d->readable)
+				continue;
+			size_t budget = SIZE_MAX;
+			if(p != FOREGROUND)
+				budget = foreground ? YIELD_SLICE : SLICE;
+			if(p == BACKGROUND)
+				budget = std::min(budget, bucket.available());
+			if(!budget)
+				continue;
+			size_t got = d->pipe[0].valid() ? d->spliceReceive(budget) : d->receive(budget);
+			if(p == BACKGROUND)
+				bucket.take(got);
+		}
+	}
+}
+
+void pollDownloaders()
+{
+	epoll_event events[MAX_EVENTS];
+	int n = epoll_wait(pollfd, events, MAX_EVENTS, pollTimeout());
+	for(int i = 0; i < n; ++i)
+	{
+		int fd = events[i].data.fd;
+		if(fd == wakefd)
+		{
+			uint64_t count;
+			while(read(wakefd, &count, sizeof(count)) > 0);
+			continue;
+		}
+		auto d = sockets.find(fd);
+		if(d != sockets.end())
+			d->second->update(fd, events[i].events);
+	}
+
+	std::vector<std::unique_ptr<Downloader>> added;
+	std::vector<int> cancels;
+	std::vector<std::pair<int, Priority>> priorities;
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		added.swap(incoming);
+		cancels.swap(cancelled);
+		cancelPending = false;
+		priorities.swap(reprioritized);
+	}
+	for(auto& d : added)
+	{
+		auto at = std::upper_bound(waiting.begin(), waiting.end(), d, byPriority);
+		waiting.insert(at, std::move(d));
+	}
+	for(int reqid : cancels)
+	{
+		for(auto& d : downloaders)
+		{
+			// the socket closes now, so the server stops sending
+			if(d->reqid == reqid && d->state != Downloader::FINISHED)
+			{
+				d->cancelled = true;
+				d->state = Downloader::FAILED;
+				d->error = "Cancelled";
+				d->closeAttempts();
+				if(d->socket.valid())
+					sockets.erase(d->socket.get());
+				d->socket.close();
+			}
+		}
+		for(auto i = waiting.begin(); i != waiting.end();)
+		{
+			if((*i)->reqid == reqid)
+				i = waiting.erase(i);
+			else
+				++i;
+		}
+	}
+	for(auto& p : priorities)
+	{
+		for(auto& d : downloaders)
+		{
+			if(d->reqid == p.first)
+				d->priority = p.second;
+		}
+		for(auto& d : waiting)
+		{
+			if(d->reqid == p.first)
+				d->priority = p.second;
+		}
+	}
+	if(priorities.size())
+		std::stable_sort(waiting.begin(), waiting.end(), byPriority);
+
+	service();
+
+	time_t now = time(0);
+	auto clock = std::chrono::steady_clock::now();
 	for(auto i = downloaders.begin(); i != downloaders.end();)
 	{
 		auto& d = *i;
-		d->update(&r, &w);
+		if(d->state == Downloader::RESOLVING && d->lookup->done)
+			d->openConnection();
+		if(d->state == Downloader::CONNECTING && d->connector && d->connector->pending() && clock >= d->connector->nextAttempt)
+			d->connectNext();
+		if((d->state == Downloader::RESOLVING || d->state == Downloader::CONNECTING) && now - d->start_time > TIMEOUT_LENGTH)
+		{
+			d->state = Downloader::FAILED;
+			d->error = "Timeout";
+		}
+		if(d->state == Downloader::FINISHED || d->state == Downloader::FAILED)
+		{
+			if(--hostConnections[d->host] == 0)
+				hostConnections.erase(d->host);
+			d->closeFile();
+		}
+		// a failed rename leaves the state FAILED, so the .part file is removed
+		if(d->state == Downloader::FINISHED && d->type == Downloader::SAVE && rename(d->tmp_path.c_str(), d->local_path.c_str()))
+		{
+			d->error = "could not rename " + d->tmp_path + ": " + strerror(errno);
+			d->state = Downloader::FAILED;
+		}
 		if(d->state == Downloader::FINISHED)
 		{
-			if(d->type == Downloader::SAVE)
-			{
-				std::cout << "Download finished: " << d->local_path << "\n";
-				if(rename(d->tmp_path.c_str(), d->local_path.c_str()))
-					std::cout << "Failed to rename " << d->tmp_path << " to " << d->local_path << "\n";
-			}
+			Message m(d->reqid, Message::FINISHED, "");
+			m.timing = d->timing;
+			queueData(std::move(m));
 			i = downloaders.erase(i);
 			continue;
 		}
 		else if(d->state == Downloader::FAILED)
 		{
-			if(d->type == Downloader::SAVE)
-			{
-				std::cout << "Downloading "<< d->local_path <<" failed: " << d->error << "\n";
-			}
-			else if(d->type == Downloader::QUEUE_DATA)
+			if(!d->cancelled)
 			{
-				queueData({d->reqid, Message::ERROR, d->error});
+				Message m(d->reqid, Message::ERROR, d->error);
+				m.timing = d->timing;
+				queueData(std::move(m));
 			}
 			i = downloaders.erase(i);
 			continue;
@@ -191,45 +665,95 @@ void pollDownloaders()
 		else
 			++i;
 	}
+	admit();
+}
+
+int newRequest()
+{
+	return ++lastRequest;
 }
 
 void runWorker()
 {
-	running = true;
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = wakefd;
+	epoll_ctl(pollfd, EPOLL_CTL_ADD, wakefd, &ev);
 	while(running)
 	{
 		pollDownloaders();
-		usleep(1000);
 	}
+	endResolver();
+	epoll_ctl(pollfd, EPOLL_CTL_DEL, wakefd, 0);
+	downloaders.clear();
+	waiting.clear();
+	hostConnections.clear();
+	std::unique_lock<std::mutex> lock(mtx);
+	incoming.clear();
+	cancelled.clear();
+	reprioritized.clear();
+}
+
+std::thread startWorker()
+{
+	running = true;
+	return std::thread(runWorker);
 }
 
 void endWorker()
 {
 	running = false;
+	wakeWorker();
 }
 
-void fetch(int reqid, const std::string& remote_path, int type)
+void fetch(int reqid, const std::string& remote_path, int type, Priority priority)
 {
-	Downloader* d = new Downloader;
-	d->reqid = reqid;
-	d->socket = -1;
-	d->remote_path = remote_path;
-	d->local_path = "";
-	d->state = Downloader::START;
-	d->type = Downloader::QUEUE_DATA;
-	std::unique_lock<std::mutex> lock(mtx);
-	downloaders.push_back(d);
+	std::unique_ptr<Downloader> d(new Downloader(reqid, remote_path, Downloader::QUEUE_DATA, priority));
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		incoming.push_back(std::move(d));
+	}
+	wakeWorker();
+}
+
+// Stops a fetch. Nothing more is queued for reqid once the worker has
+// seen the cancel, though messages queued before then are still delivered.
+void cancel(int reqid)
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		cancelled.push_back(reqid);
+		cancelPending = true;
+	}
+	wakeWorker();
+}
+
+void prioritize(int reqid, Priority priority)
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		reprioritized.push_back({reqid, priority});
+	}
+	wakeWorker();
+}
+
+void limitBackground(size_t bytesPerSecond)
+{
+	backgroundRate = bytesPerSecond;
+	wakeWorker();
 }
 
-void download(const std::string& remote_path, const std::string& local_path)
+int download(const std::string& remote_path, const std::string& local_path, size_t size, Priority priority)
 {
-	Downloader* d = new Downloader;
-	d->reqid = -1;
-	d->socket = -1;
-	d->remote_path = remote_path;
+	int reqid = newRequest();
+	std::unique_ptr<Downloader> d(new Downloader(reqid, remote_path, Downloader::SAVE, priority));
 	d->local_path = local_path;
-	d->state = Downloader::START;
-	d->type = Downloader::SAVE;
-	std::unique_lock<std::mutex> lock(mtx);
-	downloaders.push_back(d);
+	d->size = size;
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		incoming.push_back(std::move(d));
+	}
+	wakeWorker();
+	return reqid;
 }
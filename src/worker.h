@@ -1,10 +1,33 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <string>
+#include <thread>
 
-const int DL_BUFFER_SIZE = 0x100000;
+// Foreground requests are admitted and serviced first, in full. Prefetches
+// and background downloads share what is left, and background downloads
+// can be held to a rate with limitBackground().
+enum Priority { FOREGROUND, PREFETCH, BACKGROUND };
 
-void fetch(int reqid, const std::string& remote_path, int type);
-void download(const std::string& remote_path, const std::string& local_path);
+// The most connections open to one host at a time, of which prefetches
+// and background downloads may use all but one.
+const int MAX_HOST_CONNECTIONS = 4;
+
+// Whether SAVE downloads are spliced from the socket to the file instead
+// of being copied through a buffer.
+extern std::atomic<bool> spliceDownloads;
+
+int newRequest();
+void fetch(int reqid, const std::string& remote_path, int type, Priority priority = FOREGROUND);
+void prioritize(int reqid, Priority priority);
+void cancel(int reqid);
+void limitBackground(size_t bytesPerSecond);
+// Saves remote_path to local_path and returns the request id, which
+// cancel() accepts. Only FINISHED and ERROR messages are queued for it.
+int download(const std::string& remote_path, const std::string& local_path, size_t size = 0, Priority priority = BACKGROUND);
+// Starts runWorker() on a thread of its own. It is marked running before
+// the thread exists, so an endWorker() that comes first still stops it.
+std::thread startWorker();
 void endWorker();
 void runWorker();